@@ -1,4 +1,6 @@
 #include "core/task_system.h"
+#include <algorithm>
+#include <memory>
 
 void TaskSystem::init(int num_threads) {
   stop_ = false;
@@ -26,6 +28,52 @@ void TaskSystem::enqueue(std::function<void()> task) {
   cv_.notify_one();
 }
 
+void TaskSystem::run(TaskSystem *tasks, int count, const std::function<void(int)> &fn) {
+  if (tasks && count > 1) {
+    tasks->parallel_for(count, fn);
+  } else {
+    for (int i = 0; i < count; ++i)
+      fn(i);
+  }
+}
+
+void TaskSystem::parallel_for(int count, const std::function<void(int)> &fn) {
+  if (count <= 0) return;
+  int helpers = std::min((int)threads_.size(), count - 1);
+  if (helpers <= 0) {
+    for (int i = 0; i < count; ++i) fn(i);
+    return;
+  }
+
+  struct Job {
+    std::atomic<int>        next{0};
+    std::atomic<int>        done{0};
+    std::mutex              mtx;
+    std::condition_variable cv;
+  };
+  auto job = std::make_shared<Job>();
+
+  // Helpers that start after every index is claimed return without touching
+  // fn, so it only has to outlive this call.
+  auto drain = [job, count, f = &fn] {
+    int i;
+    while ((i = job->next.fetch_add(1)) < count) {
+      (*f)(i);
+      if (job->done.fetch_add(1) + 1 == count) {
+        std::lock_guard<std::mutex> lk(job->mtx);
+        job->cv.notify_all();
+      }
+    }
+  };
+
+  for (int h = 0; h < helpers; ++h)
+    enqueue(drain);
+  drain();
+
+  std::unique_lock<std::mutex> lk(job->mtx);
+  job->cv.wait(lk, [&] { return job->done.load() == count; });
+}
+
 bool TaskSystem::is_idle() const {
   std::lock_guard<std::mutex> lk(const_cast<std::mutex &>(mtx_));
   return queue_.empty() && active_count_.load() == 0;
@@ -13,6 +13,17 @@ public:
   void shutdown();
   void enqueue(std::function<void()> task);
   bool is_idle() const;
+  int  worker_count() const { return (int)threads_.size(); }
+
+  // Runs fn(i) for every i in [0, count) on the workers and the calling
+  // thread, returning once all calls have finished. The caller keeps claiming
+  // indices itself, so this is safe to use from inside an enqueued task.
+  void parallel_for(int count, const std::function<void(int)> &fn);
+
+  // parallel_for on `tasks`, or a plain loop on the calling thread when there
+  // is no task system or only one index. For code that takes an optional
+  // TaskSystem *.
+  static void run(TaskSystem *tasks, int count, const std::function<void(int)> &fn);
 
 private:
   void worker_loop();
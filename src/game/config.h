@@ -11,6 +11,7 @@ struct Config {
   static constexpr float MAP_WIDTH_UNITS  = MAP_WIDTH / HEX_SIZE;
   static constexpr float MAP_HEIGHT_UNITS = MAP_HEIGHT / HEX_SIZE;
   static constexpr float LAVA_GRID_SPACING = 10.0f;
+  static constexpr int   PREVIEW_DOWNSAMPLE = 4;
 
   static constexpr float ISO_TW = 2.0f;
   static constexpr float ISO_TH = 1.0f;
@@ -18,4 +19,5 @@ struct Config {
 
   static constexpr uint32_t LAVA_COLOR = 0xFFFF8C00;
   static constexpr float DEFAULT_CONTOUR_OPACITY = 0.35f;
+  static constexpr float CONTOUR_TOLERANCE = 0.0625f;  // world units
 };
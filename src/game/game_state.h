@@ -28,14 +28,15 @@ struct TerrainState {
 };
 
 struct AsyncTerrainState {
-  std::atomic<bool>            is_generating{false};
-  std::atomic<bool>            cancel_requested{false};
-  std::shared_ptr<TerrainMesh>      pending_mesh;
-  std::shared_ptr<MapData>          pending_map;
-  std::shared_ptr<ContourData>      pending_contours;
-  std::shared_ptr<TerrainLightBake> pending_light_bake;
-  std::mutex                   pending_mtx;
-  NoiseCache                   async_cache;
+  std::atomic<bool>                       is_generating{false};
+  std::atomic<bool>                       cancel_requested{false};
+  std::shared_ptr<const TerrainMesh>      pending_mesh;
+  std::shared_ptr<MapData>                pending_map;
+  std::shared_ptr<ContourData>            pending_contours;
+  std::shared_ptr<const TerrainLightBake> pending_light_bake;
+  std::shared_ptr<const std::vector<GpuColumnColor>> pending_column_colors;
+  std::mutex                              pending_mtx;
+  NoiseCache                              async_cache;
 };
 
 struct WindowState {
@@ -46,5 +47,5 @@ struct WindowState {
 struct ContourData {
   std::vector<float> heightmap;
   std::vector<int> band_map;
-  std::vector<Line> contour_lines;
+  ContourStrips contour_strips;
 };
@@ -113,7 +113,7 @@ static void player_movement(flecs::world &ecs, InputSystem &input,
 
 static void actor_grounding(flecs::world &ecs) {
     const auto *map_data = ecs.get<MapData>();
-    if (!map_data || map_data->basalt_height.empty()) return;
+    if (!map_data || !map_data->basalt_height) return;
 
     ecs.each([&](ActorTag, Transform &t, const ActorConfig &,
                  const LegState *) {
@@ -136,7 +136,7 @@ static void clip_selection(SkinnedRenderer &skinned_renderer, flecs::entity play
 static void gait_sync(flecs::world &ecs, SkinnedRenderer &skinned_renderer,
                       flecs::entity player) {
     const auto *map_data = ecs.get<MapData>();
-    if (!map_data || map_data->basalt_height.empty()) return;
+    if (!map_data || !map_data->basalt_height) return;
     if (!player.is_alive()) return;
 
     float dt = ecs.delta_time();
@@ -27,7 +27,7 @@ bool SkinnedRenderer::build_pipeline(SDL_Window *window) {
       SDL_GPU_SHADERSTAGE_VERTEX, 1, 1);
   SDL_GPUShader *frag = assets_->load_shader(
       "skinned_char.frag", shader_dir + "/skinned_character.frag.glsl.spv",
-      SDL_GPU_SHADERSTAGE_FRAGMENT, 1, 3, 2);
+      SDL_GPU_SHADERSTAGE_FRAGMENT, 1, 3, 3);
 
   if (!vert || !frag) {
     SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
@@ -346,6 +346,7 @@ void SkinnedRenderer::draw(SDL_GPURenderPass *pass, SDL_GPUCommandBuffer *cmd,
                            SDL_GPUBuffer *light_indices_ssbo,
                            SDL_GPUTexture *light_tex,
                            SDL_GPUSampler *light_smp,
+                           SDL_GPUTexture *light_height_tex,
                            SDL_GPUTexture *fluence_tex,
                            SDL_GPUSampler *fluence_smp) {
   if (!initialized_ || !char_loaded_ || !vbo_ || !ibo_)
@@ -359,9 +360,10 @@ void SkinnedRenderer::draw(SDL_GPURenderPass *pass, SDL_GPUCommandBuffer *cmd,
 
   SDL_BindGPUVertexStorageBuffers(pass, 0, &bone_ssbo_, 1);
 
-  SDL_GPUTextureSamplerBinding tsb[2] = {{light_tex, light_smp},
+  SDL_GPUTextureSamplerBinding tsb[3] = {{light_tex, light_smp},
+                                         {light_height_tex, light_smp},
                                          {fluence_tex, fluence_smp}};
-  SDL_BindGPUFragmentSamplers(pass, 0, tsb, 2);
+  SDL_BindGPUFragmentSamplers(pass, 0, tsb, 3);
 
   SDL_GPUBuffer *frag_ssbos[3] = {lights_ssbo, light_grid_ssbo,
                                   light_indices_ssbo};
@@ -29,6 +29,7 @@ public:
               SDL_GPUBuffer *light_indices_ssbo,
               SDL_GPUTexture *light_tex,
               SDL_GPUSampler *light_smp,
+              SDL_GPUTexture *light_height_tex,
               SDL_GPUTexture *fluence_tex,
               SDL_GPUSampler *fluence_smp);
 
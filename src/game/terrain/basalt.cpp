@@ -3,9 +3,11 @@
 #include "terrain/palettes.h"
 #include "core/types.h"
 #include "terrain/util.h"
+#include "core/task_system.h"
 #include <SDL3/SDL.h>
 #include <algorithm>
 #include <cmath>
+#include <functional>
 #include <queue>
 #include <unordered_map>
 #include <vector>
@@ -32,6 +34,12 @@ static float sample_bilinear(const std::vector<float> &map, int width,
          v01 * (1 - tx) * ty + v11 * tx * ty;
 }
 
+// A cell ID (FastNoiseLite's cell hash) mapped onto [0, 1], in the same
+// order as the cell values it also produces.
+static float worley_cell_unit(int32_t cell_id) {
+  return (float)(((double)cell_id + 2147483648.0) * (1.0 / 4294967296.0));
+}
+
 static bool hex_fits_in_plateau(int q, int r, float hex_size,
                                 std::span<const int16_t> terrain_map,
                                 int16_t plateau_id,
@@ -56,89 +64,121 @@ static bool hex_fits_in_plateau(int q, int r, float hex_size,
   return false;
 }
 
-std::vector<HexColumn>
+HexColumnsSoA
 generate_basalt_columns_v2(MapData &data, float hex_size,
-                           const WorleyBasaltParams &params) {
+                           const WorleyBasaltParams &params, TaskSystem *tasks) {
   int width = data.width;
   int height = data.height;
-  std::vector<HexColumn> columns;
 
-  HexCoord c0 = pixel_to_hex(0, 0, hex_size);
-  HexCoord c1 = pixel_to_hex(width, 0, hex_size);
-  HexCoord c2 = pixel_to_hex(0, height, hex_size);
-  HexCoord c3 = pixel_to_hex(width, height, hex_size);
+  // Hexes live on the world lattice; pixel positions are shifted into the
+  // raster by its origin.
+  const float org_x = (float)data.origin_x;
+  const float org_y = (float)data.origin_y;
+
+  HexCoord c0 = pixel_to_hex(org_x, org_y, hex_size);
+  HexCoord c1 = pixel_to_hex(org_x + width, org_y, hex_size);
+  HexCoord c2 = pixel_to_hex(org_x, org_y + height, hex_size);
+  HexCoord c3 = pixel_to_hex(org_x + width, org_y + height, hex_size);
 
   int q_min = std::min({c0.q, c1.q, c2.q, c3.q}) - 2;
   int q_max = std::max({c0.q, c1.q, c2.q, c3.q}) + 2;
   int r_min = std::min({c0.r, c1.r, c2.r, c3.r}) - 2;
   int r_max = std::max({c0.r, c1.r, c2.r, c3.r}) + 2;
 
-  for (int q = q_min; q <= q_max; ++q) {
-    for (int r = r_min; r <= r_max; ++r) {
-      float cx, cy;
-      hex_to_pixel(q, r, hex_size, cx, cy);
-
-      uint32_t hv = hash2d(q, r);
-      float jx = ((hv & 0xFF) / 255.0f - 0.5f) * hex_size * 0.3f;
-      float jy = (((hv >> 8) & 0xFF) / 255.0f - 0.5f) * hex_size * 0.3f;
-      float sx = cx + jx;
-      float sy = cy + jy;
-
-      if (sx < 0 || sx >= width - 1 || sy < 0 || sy >= height - 1)
-        continue;
-
-      int px = (int)cx;
-      int py = (int)cy;
-      if (px < 0 || px >= width || py < 0 || py >= height)
-        continue;
-
-      float cell_val = sample_bilinear(data.worley_cell_value, width, height, sx, sy);
-      if (cell_val < params.density_threshold)
-        continue;
-
-      int lx = std::clamp((int)sx, 0, width - 1);
-      int ly = std::clamp((int)sy, 0, height - 1);
-      if (data.liquid_mask[ly * width + lx])
-        continue;
-
-      float base_h = sample_bilinear(data.basalt_height, width, height, sx, sy);
-      float h = base_h;
-
-      h += cell_val * params.jitter_scale;
-
-      columns.push_back({q, r, h, base_h});
-
-      Vec2 corners[6];
-      get_hex_corners(q, r, hex_size, corners);
-      float fmin_x = 1e9f, fmax_x = -1e9f, fmin_y = 1e9f, fmax_y = -1e9f;
-      for (int i = 0; i < 6; ++i) {
-        fmin_x = std::min(fmin_x, corners[i].x);
-        fmax_x = std::max(fmax_x, corners[i].x);
-        fmin_y = std::min(fmin_y, corners[i].y);
-        fmax_y = std::max(fmax_y, corners[i].y);
-      }
-      int x0 = std::max(0, (int)fmin_x - 1);
-      int x1 = std::min(width - 1, (int)fmax_x + 1);
-      int y0 = std::max(0, (int)fmin_y - 1);
-      int y1 = std::min(height - 1, (int)fmax_y + 1);
-      for (int ry = y0; ry <= y1; ++ry) {
-        for (int rx = x0; rx <= x1; ++rx) {
-          if (pixel_in_hex((float)rx, (float)ry, q, r, hex_size))
-            data.terrain_map[ry * width + rx] = TERRAIN_BASALT;
-        }
+  // Placement only reads the noise layers, so q stripes run independently;
+  // concatenating them in stripe order gives the serial q-major order.
+  constexpr int STRIPE_Q = 16;
+  int stripe_count = (q_max - q_min) / STRIPE_Q + 1;
+  std::vector<HexColumnsSoA> stripes(stripe_count);
+  TaskSystem::run(tasks, stripe_count, [&](int s) {
+    HexColumnsSoA &out = stripes[s];
+    int q_end = std::min(q_max, q_min + (s + 1) * STRIPE_Q - 1);
+    for (int q = q_min + s * STRIPE_Q; q <= q_end; ++q) {
+      for (int r = r_min; r <= r_max; ++r) {
+        float cx, cy;
+        hex_to_pixel(q, r, hex_size, cx, cy);
+        cx -= org_x;
+        cy -= org_y;
+
+        uint32_t hv = hash2d(q, r);
+        float jx = ((hv & 0xFF) / 255.0f - 0.5f) * hex_size * 0.3f;
+        float jy = (((hv >> 8) & 0xFF) / 255.0f - 0.5f) * hex_size * 0.3f;
+        float sx = cx + jx;
+        float sy = cy + jy;
+
+        if (sx < 0 || sx >= width - 1 || sy < 0 || sy >= height - 1)
+          continue;
+
+        int px = (int)cx;
+        int py = (int)cy;
+        if (px < 0 || px >= width || py < 0 || py >= height)
+          continue;
+
+        int lx = std::clamp((int)sx, 0, width - 1);
+        int ly = std::clamp((int)sy, 0, height - 1);
+
+        // Whether a column grows, and how far it rises, is decided by the
+        // Worley cell its sample lands in, so all columns of a cell agree and
+        // the choice does not move with the map's cell value range.
+        float cell_val = worley_cell_unit((*data.worley_cell_id)[ly * width + lx]);
+        if (cell_val < params.density_threshold)
+          continue;
+
+        if ((*data.liquid_mask)[ly * width + lx])
+          continue;
+
+        float base_h = sample_bilinear(*data.basalt_height, width, height, sx, sy);
+        float h = base_h;
+
+        h += cell_val * params.jitter_scale;
+
+        out.push_back(q, r, h, base_h);
       }
     }
+  });
+
+  HexColumnsSoA columns;
+  size_t total = 0;
+  for (const auto &stripe : stripes)
+    total += stripe.size();
+  columns.reserve(total);
+  for (const auto &stripe : stripes)
+    columns.append(stripe);
+  stripes.clear();
+
+  // Neighbouring footprints overlap, so terrain_map is filled by row band
+  // instead: each column is bucketed into the bands its rows can reach and
+  // every band writes only its own rows.
+  constexpr int BAND_ROWS = 64;
+  int band_count = (height + BAND_ROWS - 1) / BAND_ROWS;
+  std::vector<std::vector<uint32_t>> band_columns(band_count);
+  const float reach = hex_size + 2.0f;
+  for (uint32_t i = 0; i < (uint32_t)columns.size(); ++i) {
+    float cx, cy;
+    hex_to_pixel(columns.q[i], columns.r[i], hex_size, cx, cy);
+    cy -= org_y;
+    int b0 = std::max(0, (int)std::floor(cy - reach) / BAND_ROWS);
+    int b1 = std::min(band_count - 1, (int)std::ceil(cy + reach) / BAND_ROWS);
+    for (int b = b0; b <= b1; ++b)
+      band_columns[b].push_back(i);
   }
+  TaskSystem::run(tasks, band_count, [&](int b) {
+    int y0 = b * BAND_ROWS;
+    int y1 = std::min(height, y0 + BAND_ROWS);
+    std::vector<HexSpan> spans;
+    for (uint32_t i : band_columns[b]) {
+      rasterize_hex(columns.q[i], columns.r[i], hex_size, org_x, org_y, width, height, spans);
+      for (const HexSpan &sp : spans) {
+        if (sp.y < y0 || sp.y >= y1)
+          continue;
+        int16_t *row = data.terrain_map.data() + (size_t)sp.y * width;
+        std::fill(row + sp.x0, row + sp.x1 + 1, TERRAIN_BASALT);
+      }
+    }
+  });
 
   SDL_Log("generate_basalt_columns_v2: %zu columns", columns.size());
 
-  for (auto &col : columns) {
-    for (int i = 0; i < 6; ++i) {
-      col.visible_edges[i] = false;
-      col.edge_drops[i] = 0.0f;
-    }
-  }
-
   compute_visible_edges(columns);
   return columns;
 }
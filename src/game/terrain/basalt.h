@@ -5,6 +5,7 @@
 #include <vector>
 
 struct MapData;
+class TaskSystem;
 
 struct WorleyBasaltParams {
   float density_threshold = 0.2f;
@@ -12,6 +13,10 @@ struct WorleyBasaltParams {
   float edge_threshold = 0.7f;
 };
 
-std::vector<HexColumn>
+// Places columns on the hex lattice over the raster and marks their
+// footprints in terrain_map. Placement runs in q stripes and the footprint
+// fill in row bands; the result is identical with or without `tasks`.
+HexColumnsSoA
 generate_basalt_columns_v2(MapData &data, float hex_size,
-                           const WorleyBasaltParams &params = {});
+                           const WorleyBasaltParams &params = {},
+                           TaskSystem *tasks = nullptr);
@@ -0,0 +1,179 @@
+#include "terrain/components.h"
+#include "core/task_system.h"
+#include <algorithm>
+#include <functional>
+
+namespace {
+
+struct Run {
+  int32_t x0, x1;  // inclusive
+  int32_t y;
+  int32_t cls;
+};
+
+constexpr int BAND_ROWS = 64;
+
+int32_t find_root(std::vector<int32_t> &parent, int32_t i) {
+  while (parent[i] != i) {
+    parent[i] = parent[parent[i]];
+    i = parent[i];
+  }
+  return i;
+}
+
+// The smaller index always becomes the root, so a component's root is its
+// first run in raster order.
+void unite(std::vector<int32_t> &parent, int32_t a, int32_t b) {
+  a = find_root(parent, a);
+  b = find_root(parent, b);
+  if (a < b)
+    parent[b] = a;
+  else if (b < a)
+    parent[a] = b;
+}
+
+// Joins each run of row y with the same-class runs of row y - 1 it touches.
+// [ext_lo, ext_hi] widens the run by the diagonal reach of the connectivity.
+void connect_rows(const std::vector<Run> &runs, int32_t prev_begin, int32_t prev_end,
+                  int32_t cur_begin, int32_t cur_end, int ext_lo, int ext_hi,
+                  std::vector<int32_t> &parent) {
+  int32_t j = prev_begin;
+  for (int32_t i = cur_begin; i < cur_end; ++i) {
+    int lo = runs[i].x0 - ext_lo;
+    int hi = runs[i].x1 + ext_hi;
+    while (j < prev_end && runs[j].x1 < lo)
+      ++j;
+    for (int32_t k = j; k < prev_end && runs[k].x0 <= hi; ++k)
+      if (runs[k].cls == runs[i].cls)
+        unite(parent, k, i);
+  }
+}
+
+} // namespace
+
+ComponentRuns label_component_runs(int width, int height, const ClassRowFn &row_classes,
+                                   Connectivity connectivity, TaskSystem *tasks) {
+  ComponentRuns out;
+  out.width = width;
+  out.height = height;
+  if (width <= 0 || height <= 0)
+    return out;
+
+  // A run [x0, x1] touches pixels x0 - ext_lo .. x1 + ext_hi of the row above.
+  int ext_lo = connectivity == Connectivity::Eight ? 1 : 0;
+  int ext_hi = connectivity == Connectivity::Four ? 0 : 1;
+
+  int band_count = (height + BAND_ROWS - 1) / BAND_ROWS;
+
+  // Pass 1: runs per band.
+  std::vector<std::vector<Run>> band_runs(band_count);
+  std::vector<int32_t> &row_begin = out.row_begin;
+  row_begin.assign(height + 1, 0);
+  TaskSystem::run(tasks, band_count, [&](int b) {
+    int y0 = b * BAND_ROWS;
+    int y1 = std::min(height, y0 + BAND_ROWS);
+    std::vector<Run> &runs = band_runs[b];
+    std::vector<int32_t> row(width);
+    for (int y = y0; y < y1; ++y) {
+      row_classes(y, row.data());
+      size_t before = runs.size();
+      int x = 0;
+      while (x < width) {
+        int32_t cls = row[x];
+        int start = x;
+        while (++x < width && row[x] == cls) {}
+        if (cls >= 0)
+          runs.push_back({start, x - 1, y, cls});
+      }
+      row_begin[y + 1] = (int32_t)(runs.size() - before);
+    }
+  });
+  for (int y = 0; y < height; ++y)
+    row_begin[y + 1] += row_begin[y];
+
+  // Pass 2: gather runs and union within each band.
+  std::vector<Run> runs(row_begin[height]);
+  std::vector<int32_t> parent(runs.size());
+  TaskSystem::run(tasks, band_count, [&](int b) {
+    int y0 = b * BAND_ROWS;
+    int y1 = std::min(height, y0 + BAND_ROWS);
+    std::copy(band_runs[b].begin(), band_runs[b].end(), runs.begin() + row_begin[y0]);
+    std::vector<Run>().swap(band_runs[b]);
+    for (int32_t i = row_begin[y0]; i < row_begin[y1]; ++i)
+      parent[i] = i;
+    for (int y = y0 + 1; y < y1; ++y)
+      connect_rows(runs, row_begin[y - 1], row_begin[y], row_begin[y], row_begin[y + 1],
+                   ext_lo, ext_hi, parent);
+  });
+  band_runs.clear();
+
+  // Band seams, serially.
+  for (int b = 1; b < band_count; ++b) {
+    int y = b * BAND_ROWS;
+    connect_rows(runs, row_begin[y - 1], row_begin[y], row_begin[y], row_begin[y + 1],
+                 ext_lo, ext_hi, parent);
+  }
+
+  // Roots come first in raster order, so labelling in run order numbers
+  // components by their first pixel, and a root is labelled before any run
+  // that refers to it.
+  out.runs.resize(runs.size());
+  for (size_t i = 0; i < runs.size(); ++i) {
+    const Run &r = runs[i];
+    int32_t root = find_root(parent, (int32_t)i);
+    int32_t label;
+    if (root == (int32_t)i) {
+      label = (int32_t)out.components.size();
+      ComponentStats s;
+      s.cls = r.cls;
+      s.min_x = r.x0;
+      s.max_x = r.x1;
+      s.min_y = s.max_y = r.y;
+      s.first_pixel = r.y * width + r.x0;
+      out.components.push_back(s);
+    } else {
+      label = out.runs[root].label;
+    }
+    out.runs[i] = {r.x0, r.x1, r.y, label};
+
+    ComponentStats &s = out.components[label];
+    s.area += r.x1 - r.x0 + 1;
+    s.min_x = std::min(s.min_x, r.x0);
+    s.max_x = std::max(s.max_x, r.x1);
+    s.max_y = r.y;
+  }
+
+  return out;
+}
+
+ComponentLabels label_components(const std::vector<int32_t> &classes, int width,
+                                 int height, Connectivity connectivity,
+                                 TaskSystem *tasks) {
+  ComponentLabels out;
+  out.width = width;
+  out.height = height;
+  if (width <= 0 || height <= 0)
+    return out;
+
+  ComponentRuns cr = label_component_runs(
+      width, height,
+      [&](int y, int32_t *row) {
+        std::copy_n(classes.data() + (size_t)y * width, width, row);
+      },
+      connectivity, tasks);
+
+  // Paint the label image, one band of rows per task.
+  out.labels.assign((size_t)width * height, -1);
+  int band_count = (height + BAND_ROWS - 1) / BAND_ROWS;
+  TaskSystem::run(tasks, band_count, [&](int b) {
+    int y0 = b * BAND_ROWS;
+    int y1 = std::min(height, y0 + BAND_ROWS);
+    for (int32_t i = cr.row_begin[y0]; i < cr.row_begin[y1]; ++i) {
+      const ComponentRun &r = cr.runs[i];
+      int32_t *row = out.labels.data() + (size_t)r.y * width;
+      std::fill(row + r.x0, row + r.x1 + 1, r.label);
+    }
+  });
+  out.components = std::move(cr.components);
+  return out;
+}
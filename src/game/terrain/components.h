@@ -0,0 +1,71 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+class TaskSystem;
+
+// Which neighbours join a pixel to its component. HexAxial treats the grid
+// as axial hex coordinates (x = q, y = r): the four edge neighbours plus
+// (+1, -1) and (-1, +1).
+enum class Connectivity { Four, Eight, HexAxial };
+
+struct ComponentStats {
+  int32_t cls = 0;
+  int area = 0;
+  int min_x = 0, min_y = 0, max_x = 0, max_y = 0;
+  int first_pixel = 0;  // raster index of the component's first pixel
+
+  bool touches_border(int width, int height) const {
+    return min_x == 0 || min_y == 0 || max_x == width - 1 || max_y == height - 1;
+  }
+};
+
+struct ComponentLabels {
+  int width = 0;
+  int height = 0;
+  std::vector<int32_t> labels;  // -1 on background pixels
+  std::vector<ComponentStats> components;
+
+  int count() const { return (int)components.size(); }
+};
+
+// One horizontal run of a labelled component; x0..x1 inclusive.
+struct ComponentRun {
+  int32_t x0, x1;
+  int32_t y;
+  int32_t label;
+};
+
+// Components as runs, without a per-pixel label image. Runs are in raster
+// order and row y's runs are [row_begin[y], row_begin[y + 1]).
+struct ComponentRuns {
+  int width = 0;
+  int height = 0;
+  std::vector<ComponentRun> runs;
+  std::vector<int32_t> row_begin;
+  std::vector<ComponentStats> components;
+
+  int count() const { return (int)components.size(); }
+};
+
+// Writes the classes of row y into row[0 .. width); below zero is
+// background. Called once per row, concurrently for different rows.
+using ClassRowFn = std::function<void(int y, int32_t *row)>;
+
+// Streaming form of label_components: classes are produced a row at a time
+// and only the runs are kept, so memory follows the number of runs rather
+// than the pixel count. Labels match label_components on the same classes.
+ComponentRuns label_component_runs(int width, int height, const ClassRowFn &row_classes,
+                                   Connectivity connectivity = Connectivity::Four,
+                                   TaskSystem *tasks = nullptr);
+
+// Labels the connected components of a class image: neighbouring pixels
+// with the same class share a label, classes below zero are background.
+// Works on horizontal runs with a union-find over them, one row band per
+// task, so memory is proportional to the number of runs rather than a
+// per-pixel queue. Labels are numbered in raster order of each component's
+// first pixel, so the result does not depend on the band split.
+ComponentLabels label_components(const std::vector<int32_t> &classes, int width,
+                                 int height, Connectivity connectivity = Connectivity::Four,
+                                 TaskSystem *tasks = nullptr);
@@ -1,106 +1,289 @@
 #include "terrain/contour.h"
+#include "core/task_system.h"
 #include <SDL3/SDL.h>
 #include <algorithm>
+#include <bit>
 #include <cmath>
-#include <queue>
+#include <unordered_map>
+
+namespace {
+
+constexpr int BAND_ROWS = 32;
+
+// Marching squares for one cell at one level; config is neither 0 nor 15.
+// Every crossing is interpolated from the left or top corner of its edge,
+// so the neighbouring cell computes the identical point.
+void emit_cell(float h00, float h10, float h11, float h01, float fx, float fy,
+               float level, std::vector<Line> &out) {
+  float points[4][2];
+  int point_count = 0;
+
+  if ((h00 < level && h10 >= level) || (h00 >= level && h10 < level)) {
+    float t = (level - h00) / (h10 - h00);
+    points[point_count][0] = fx + t;
+    points[point_count][1] = fy;
+    point_count++;
+  }
+
+  if ((h10 < level && h11 >= level) || (h10 >= level && h11 < level)) {
+    float t = (level - h10) / (h11 - h10);
+    points[point_count][0] = fx + 1;
+    points[point_count][1] = fy + t;
+    point_count++;
+  }
+
+  if ((h11 < level && h01 >= level) || (h11 >= level && h01 < level)) {
+    float t = (level - h01) / (h11 - h01);
+    points[point_count][0] = fx + t;
+    points[point_count][1] = fy + 1;
+    point_count++;
+  }
+
+  if ((h01 < level && h00 >= level) || (h01 >= level && h00 < level)) {
+    float t = (level - h00) / (h01 - h00);
+    points[point_count][0] = fx;
+    points[point_count][1] = fy + t;
+    point_count++;
+  }
+
+  if (point_count == 2) {
+    out.push_back({points[0][0], points[0][1], points[1][0], points[1][1], level});
+  } else if (point_count == 4) {
+    float center = (h00 + h10 + h11 + h01) * 0.25f;
+    if (center >= level) {
+      out.push_back({points[0][0], points[0][1], points[1][0], points[1][1], level});
+      out.push_back({points[2][0], points[2][1], points[3][0], points[3][1], level});
+    } else {
+      out.push_back({points[0][0], points[0][1], points[3][0], points[3][1], level});
+      out.push_back({points[1][0], points[1][1], points[2][0], points[2][1], level});
+    }
+  }
+}
+
+} // namespace
 
 void extract_contours(std::span<const float> heightmap, int width, int height,
                       float interval, std::vector<Line> &out_lines,
-                      std::vector<int> &out_band_map) {
+                      std::vector<int> &out_band_map, TaskSystem *tasks) {
   out_lines.clear();
 
-  constexpr size_t MAX_CONTOUR_LINES = 500'000;
+  // Accumulated exactly as the contour levels always have been.
+  std::vector<float> levels;
+  for (float level = interval * 0.5f; level < 1.0f; level += interval)
+    levels.push_back(level);
+  const int level_count = (int)levels.size();
 
   int total = width * height;
   out_band_map.resize(total);
-  for (int i = 0; i < total; ++i) {
-    out_band_map[i] = (int)(heightmap[i] / interval);
-  }
 
-  for (float level = interval * 0.5f; level < 1.0f; level += interval) {
-    for (int y = 0; y < height - 1; ++y) {
+  // Each band of cell rows sweeps its cells once, emitting the segments of
+  // every level inside a cell's height range into that level's list.
+  int cell_rows = std::max(0, height - 1);
+  int band_count = std::max(1, (cell_rows + BAND_ROWS - 1) / BAND_ROWS);
+  std::vector<std::vector<Line>> band_lines((size_t)band_count * level_count);
+  auto sweep_band = [&](int b) {
+    int y0 = b * BAND_ROWS;
+    int y1 = std::min(cell_rows, y0 + BAND_ROWS);
+    int band_map_end = b == band_count - 1 ? height : y1;
+    for (int y = y0; y < band_map_end; ++y)
+      for (int x = 0; x < width; ++x)
+        out_band_map[y * width + x] = (int)(heightmap[y * width + x] / interval);
+    if (level_count == 0)
+      return;
+
+    std::vector<Line> *lines = band_lines.data() + (size_t)b * level_count;
+    for (int y = y0; y < y1; ++y) {
+      const float *row0 = heightmap.data() + (size_t)y * width;
+      const float *row1 = row0 + width;
       for (int x = 0; x < width - 1; ++x) {
-        if (out_lines.size() >= MAX_CONTOUR_LINES) {
-          SDL_Log("extract_contours: hit %zu line cap, truncating",
-                  MAX_CONTOUR_LINES);
-          return;
-        }
+        float h00 = row0[x];
+        float h10 = row0[x + 1];
+        float h01 = row1[x];
+        float h11 = row1[x + 1];
+        float lo = std::min(std::min(h00, h10), std::min(h01, h11));
+        float hi = std::max(std::max(h00, h10), std::max(h01, h11));
 
-        float h00 = heightmap[y * width + x];
-        float h10 = heightmap[y * width + x + 1];
-        float h01 = heightmap[(y + 1) * width + x];
-        float h11 = heightmap[(y + 1) * width + x + 1];
+        // Levels in (lo, hi] have corners on both sides; flat cells have none.
+        if (!(lo < hi))
+          continue;
+        int k = (int)std::clamp(std::floor((lo - levels[0]) / interval), 0.0f,
+                                (float)level_count);
+        while (k > 0 && levels[k - 1] > lo)
+          --k;
+        while (k < level_count && levels[k] <= lo)
+          ++k;
+        for (; k < level_count && levels[k] <= hi; ++k)
+          emit_cell(h00, h10, h11, h01, (float)x, (float)y, levels[k], lines[k]);
+      }
+    }
+  };
+  TaskSystem::run(tasks, band_count, sweep_band);
 
-        int config = ((h00 >= level) << 0) | ((h10 >= level) << 1) |
-                     ((h11 >= level) << 2) | ((h01 >= level) << 3);
+  // Level-major, then band order: the order of one level-by-level sweep.
+  size_t line_count = 0;
+  for (const auto &lines : band_lines)
+    line_count += lines.size();
+  out_lines.reserve(line_count);
+  for (int k = 0; k < level_count; ++k) {
+    for (int b = 0; b < band_count; ++b) {
+      const std::vector<Line> &lines = band_lines[(size_t)b * level_count + k];
+      out_lines.insert(out_lines.end(), lines.begin(), lines.end());
+    }
+  }
+}
 
-        if (config == 0 || config == 15)
-          continue;
+size_t ContourStrips::segment_count() const {
+  size_t n = 0;
+  for (size_t s = 0; s < strip_count(); ++s) {
+    size_t count = strip_begin[s + 1] - strip_begin[s];
+    n += closed[s] ? count : count - 1;
+  }
+  return n;
+}
 
-        float fx = (float)x, fy = (float)y;
-        float points[4][2];
-        int point_count = 0;
+void ContourStrips::clear() {
+  points.clear();
+  strip_begin.assign(1, 0);
+  elevations.clear();
+  closed.clear();
+}
 
-        if ((h00 < level && h10 >= level) || (h00 >= level && h10 < level)) {
-          float t = (level - h00) / (h10 - h00);
-          points[point_count][0] = fx + t;
-          points[point_count][1] = fy;
-          point_count++;
-        }
+ContourStrips stitch_contours(std::span<const Line> lines, float tolerance,
+                              TaskSystem *tasks) {
+  // Lines are grouped by level; each level is stitched on its own.
+  std::vector<size_t> level_begin;
+  for (size_t i = 0; i < lines.size(); ++i)
+    if (i == 0 || lines[i].elevation != lines[i - 1].elevation)
+      level_begin.push_back(i);
+  level_begin.push_back(lines.size());
+  int level_count = (int)level_begin.size() - 1;
 
-        if ((h10 < level && h11 >= level) || (h10 >= level && h11 < level)) {
-          float t = (level - h10) / (h11 - h10);
-          points[point_count][0] = fx + 1;
-          points[point_count][1] = fy + t;
-          point_count++;
-        }
+  std::vector<ContourStrips> per_level(level_count);
+  auto stitch_level = [&](int k) {
+    std::span<const Line> seg = lines.subspan(level_begin[k], level_begin[k + 1] - level_begin[k]);
+    ContourStrips &out = per_level[k];
+    size_t n = seg.size();
+    auto point = [&](uint32_t e) {
+      const Line &l = seg[e >> 1];
+      return (e & 1) ? ContourPoint{l.x2, l.y2} : ContourPoint{l.x1, l.y1};
+    };
 
-        if ((h11 < level && h01 >= level) || (h11 >= level && h01 < level)) {
-          float t = (level - h11) / (h01 - h11);
-          points[point_count][0] = fx + 1 - t;
-          points[point_count][1] = fy + 1;
-          point_count++;
-        }
+    // Endpoint e of segment e / 2 is linked to the endpoint with the same
+    // coordinates; a third point at the same spot starts a new pairing.
+    constexpr uint32_t NONE = UINT32_MAX;
+    std::vector<uint32_t> link(2 * n, NONE);
+    std::unordered_map<uint64_t, uint32_t> open_ends;
+    open_ends.reserve(2 * n);
+    for (uint32_t e = 0; e < 2 * n; ++e) {
+      ContourPoint p = point(e);
+      uint64_t key = (uint64_t)std::bit_cast<uint32_t>(p.x) << 32 | std::bit_cast<uint32_t>(p.y);
+      auto [it, inserted] = open_ends.try_emplace(key, e);
+      if (inserted)
+        continue;
+      link[e] = it->second;
+      link[it->second] = e;
+      open_ends.erase(it);
+    }
+    std::unordered_map<uint64_t, uint32_t>().swap(open_ends);
 
-        if ((h01 < level && h00 >= level) || (h01 >= level && h00 < level)) {
-          float t = (level - h01) / (h00 - h01);
-          points[point_count][0] = fx;
-          points[point_count][1] = fy + 1 - t;
-          point_count++;
+    // Walk chains from their free ends first, then the remaining loops.
+    std::vector<uint8_t> used(n, 0);
+    std::vector<ContourPoint> chain;
+    std::vector<uint8_t> keep;
+    std::vector<std::pair<uint32_t, uint32_t>> stack;
+    auto walk = [&](uint32_t entry) {
+      chain.clear();
+      chain.push_back(point(entry));
+      uint32_t e = entry;
+      bool loop = false;
+      for (;;) {
+        used[e >> 1] = 1;
+        chain.push_back(point(e ^ 1));
+        uint32_t next = link[e ^ 1];
+        if (next == NONE)
+          break;
+        if (next == entry) {
+          loop = true;
+          break;
         }
+        if (used[next >> 1])
+          break;
+        e = next;
+      }
 
-        if (point_count == 2) {
-          out_lines.push_back(
-              {points[0][0], points[0][1], points[1][0], points[1][1], level});
-        } else if (point_count == 4) {
-          float center = (h00 + h10 + h11 + h01) * 0.25f;
-          if (center >= level) {
-            out_lines.push_back({points[0][0], points[0][1], points[1][0],
-                                 points[1][1], level});
-            out_lines.push_back({points[2][0], points[2][1], points[3][0],
-                                 points[3][1], level});
+      // Douglas-Peucker; a loop's repeated first point anchors both ends.
+      keep.assign(chain.size(), 0);
+      keep.front() = keep.back() = 1;
+      float tol2 = tolerance * tolerance;
+      stack.assign(1, {0u, (uint32_t)chain.size() - 1});
+      while (!stack.empty()) {
+        auto [a, b] = stack.back();
+        stack.pop_back();
+        if (b - a < 2)
+          continue;
+        ContourPoint pa = chain[a], pb = chain[b];
+        float dx = pb.x - pa.x, dy = pb.y - pa.y;
+        float len2 = dx * dx + dy * dy;
+        float best = -1.0f;
+        uint32_t best_i = a;
+        for (uint32_t i = a + 1; i < b; ++i) {
+          float px = chain[i].x - pa.x, py = chain[i].y - pa.y;
+          float d2;
+          if (len2 > 0.0f) {
+            float cross = px * dy - py * dx;
+            d2 = cross * cross / len2;
           } else {
-            out_lines.push_back({points[0][0], points[0][1], points[3][0],
-                                 points[3][1], level});
-            out_lines.push_back({points[1][0], points[1][1], points[2][0],
-                                 points[2][1], level});
+            d2 = px * px + py * py;
+          }
+          if (d2 > best) {
+            best = d2;
+            best_i = i;
           }
         }
+        if (best > tol2) {
+          keep[best_i] = 1;
+          stack.push_back({a, best_i});
+          stack.push_back({best_i, b});
+        }
       }
-    }
-  }
-}
 
-void simplify_contours(std::vector<Line> &lines, float epsilon) {
-  float eps2 = epsilon * epsilon;
-  size_t before = lines.size();
-  lines.erase(std::remove_if(lines.begin(), lines.end(),
-                             [eps2](const Line &l) {
-                               float dx = l.x2 - l.x1;
-                               float dy = l.y2 - l.y1;
-                               return (dx * dx + dy * dy) < eps2;
-                             }),
-              lines.end());
-  SDL_Log("simplify_contours: %zu -> %zu segments (epsilon=%.2f)", before,
-          lines.size(), epsilon);
+      size_t last = loop ? chain.size() - 1 : chain.size();
+      size_t begin = out.points.size();
+      for (size_t i = 0; i < last; ++i)
+        if (keep[i])
+          out.points.push_back(chain[i]);
+      // A loop thinner than the tolerance collapses to a line; drop it.
+      if (loop && out.points.size() - begin < 3) {
+        out.points.resize(begin);
+        return;
+      }
+      out.strip_begin.push_back((uint32_t)out.points.size());
+      out.elevations.push_back(seg.front().elevation);
+      out.closed.push_back(loop ? 1 : 0);
+    };
+    for (uint32_t e = 0; e < 2 * n; ++e)
+      if (link[e] == NONE && !used[e >> 1])
+        walk(e);
+    for (uint32_t s = 0; s < n; ++s)
+      if (!used[s])
+        walk(2 * s);
+  };
+  TaskSystem::run(tasks, level_count, stitch_level);
+
+  ContourStrips out;
+  size_t point_count = 0;
+  for (const ContourStrips &s : per_level)
+    point_count += s.points.size();
+  out.points.reserve(point_count);
+  for (const ContourStrips &s : per_level) {
+    uint32_t base = (uint32_t)out.points.size();
+    out.points.insert(out.points.end(), s.points.begin(), s.points.end());
+    for (size_t i = 1; i < s.strip_begin.size(); ++i)
+      out.strip_begin.push_back(base + s.strip_begin[i]);
+    out.elevations.insert(out.elevations.end(), s.elevations.begin(), s.elevations.end());
+    out.closed.insert(out.closed.end(), s.closed.begin(), s.closed.end());
+  }
+  SDL_Log("stitch_contours: %zu segments -> %zu strips, %zu points (tolerance=%.2f)",
+          lines.size(), out.strip_count(), out.points.size(), tolerance);
+  return out;
 }
@@ -8,8 +8,38 @@ struct Line {
   float elevation;
 };
 
+struct ContourPoint {
+  float x, y;
+};
+
+// Contour polylines. Strip s is points[strip_begin[s] .. strip_begin[s + 1])
+// at elevations[s]; a closed strip also joins its last point to its first.
+struct ContourStrips {
+  std::vector<ContourPoint> points;
+  std::vector<uint32_t> strip_begin{0};
+  std::vector<float> elevations;
+  std::vector<uint8_t> closed;
+
+  size_t strip_count() const { return elevations.size(); }
+  size_t segment_count() const;
+  void clear();
+};
+
+class TaskSystem;
+
+// Marching-squares contours at interval * (k + 0.5) below 1.0. One sweep
+// over the cells emits every level a cell spans, in bands of rows across
+// `tasks`; lines come out level by level in raster order either way. A
+// crossing is interpolated along its grid edge the same way by both cells
+// that share the edge, so segment endpoints meet exactly.
 void extract_contours(std::span<const float> heightmap, int width, int height,
                       float interval, std::vector<Line> &out_lines,
-                      std::vector<int> &out_band_map);
+                      std::vector<int> &out_band_map, TaskSystem *tasks = nullptr);
 
-void simplify_contours(std::vector<Line> &lines, float epsilon);
+// Joins segments that share an endpoint into polylines through a hashed
+// endpoint index, then simplifies each polyline with Douglas-Peucker so no
+// dropped point is further than `tolerance` (in line units) from the
+// result. Open ends are kept, so contours still meet at map and chunk
+// borders. Levels are stitched one per task.
+ContourStrips stitch_contours(std::span<const Line> lines, float tolerance,
+                              TaskSystem *tasks = nullptr);
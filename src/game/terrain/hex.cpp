@@ -1,7 +1,6 @@
 #include "terrain/hex.h"
 #include <algorithm>
 #include <cmath>
-#include <unordered_map>
 
 void hex_to_pixel(int q, int r, float hex_size, float &out_x, float &out_y) {
   const float sqrt3 = 1.7320508f;
@@ -31,20 +30,26 @@ HexCoord pixel_to_hex(float x, float y, float hex_size) {
   return {iq, ir};
 }
 
-void get_hex_corners(int q, int r, float hex_size, Vec2 corners[6]) {
-  const float PI = 3.14159265359f;
-  float cx, cy;
-  hex_to_pixel(q, r, hex_size, cx, cy);
-  for (int i = 0; i < 6; ++i) {
-    float angle = i * PI / 3.0f;
-    corners[i].x = cx + hex_size * std::cos(angle);
-    corners[i].y = cy + hex_size * std::sin(angle);
+namespace {
+
+struct UnitCorners {
+  float x[6], y[6];
+  UnitCorners() {
+    const float PI = 3.14159265359f;
+    for (int i = 0; i < 6; ++i) {
+      float angle = i * PI / 3.0f;
+      x[i] = std::cos(angle);
+      y[i] = std::sin(angle);
+    }
   }
+};
+
+const UnitCorners &unit_corners() {
+  static const UnitCorners corners;
+  return corners;
 }
 
-bool pixel_in_hex(float px, float py, int q, int r, float hex_size) {
-  Vec2 corners[6];
-  get_hex_corners(q, r, hex_size, corners);
+bool inside_corners(float px, float py, const Vec2 corners[6]) {
   for (int i = 0; i < 6; ++i) {
     int next = (i + 1) % 6;
     float edge_x = corners[next].x - corners[i].x;
@@ -57,29 +62,201 @@ bool pixel_in_hex(float px, float py, int q, int r, float hex_size) {
   return true;
 }
 
-void compute_visible_edges(std::vector<HexColumn> &columns) {
-  std::unordered_map<HexCoord, HexColumn *, HexHash> col_map;
-  for (auto &col : columns) {
-    HexCoord key = {col.q, col.r};
-    col_map[key] = &col;
+} // namespace
+
+void get_hex_corners(int q, int r, float hex_size, Vec2 corners[6]) {
+  const UnitCorners &unit = unit_corners();
+  float cx, cy;
+  hex_to_pixel(q, r, hex_size, cx, cy);
+  for (int i = 0; i < 6; ++i) {
+    corners[i].x = cx + hex_size * unit.x[i];
+    corners[i].y = cy + hex_size * unit.y[i];
+  }
+}
+
+bool pixel_in_hex(float px, float py, int q, int r, float hex_size) {
+  Vec2 corners[6];
+  get_hex_corners(q, r, hex_size, corners);
+  return inside_corners(px, py, corners);
+}
+
+void rasterize_hex(int q, int r, float hex_size, float org_x, float org_y, int width,
+                   int height, std::vector<HexSpan> &spans) {
+  spans.clear();
+  Vec2 corners[6];
+  get_hex_corners(q, r, hex_size, corners);
+
+  // Same clip box the per-pixel loops used: corner bounds plus one pixel.
+  float fmin_x = 1e9f, fmax_x = -1e9f, fmin_y = 1e9f, fmax_y = -1e9f;
+  for (int i = 0; i < 6; ++i) {
+    fmin_x = std::min(fmin_x, corners[i].x - org_x);
+    fmax_x = std::max(fmax_x, corners[i].x - org_x);
+    fmin_y = std::min(fmin_y, corners[i].y - org_y);
+    fmax_y = std::max(fmax_y, corners[i].y - org_y);
   }
-  const int neighbors[6][2] = {{1,0},{0,1},{-1,1},{-1,0},{0,-1},{1,-1}};
-  for (auto &col : columns) {
-    for (int i = 0; i < 6; ++i) {
-      col.visible_edges[i] = false;
-      col.edge_drops[i]    = 0.0f;
-      HexCoord nb = {col.q + neighbors[i][0], col.r + neighbors[i][1]};
-      auto it = col_map.find(nb);
-      if (it == col_map.end()) {
-        col.visible_edges[i] = true;
-        col.edge_drops[i]    = col.height;
-      } else {
-        float diff = col.height - it->second->height;
-        if (diff > HEX_MIN_WALL_DROP) {
-          col.visible_edges[i] = true;
-          col.edge_drops[i]    = diff;
-        }
-      }
+  int x0 = std::max(0, (int)fmin_x - 1);
+  int x1 = std::min(width - 1, (int)fmax_x + 1);
+  int y0 = std::max(0, (int)fmin_y - 1);
+  int y1 = std::min(height - 1, (int)fmax_y + 1);
+  if (x0 > x1)
+    return;
+
+  // Flat-topped hex: half-height s*sqrt(3)/2, half-width s - |dy|/sqrt(3).
+  const float inv_sqrt3 = 0.57735027f;
+  float cx, cy;
+  hex_to_pixel(q, r, hex_size, cx, cy);
+  cx -= org_x;
+  cy -= org_y;
+  const float half_h = hex_size * 0.8660254f;
+
+  auto inside = [&](int x, float py) { return inside_corners((float)x + org_x, py, corners); };
+
+  // Each edge test is monotone in x along a row, so coverage is one run and
+  // the analytic ends are exact to within a pixel; the edge test settles them.
+  for (int y = y0; y <= y1; ++y) {
+    float dy = std::abs((float)y - cy);
+    if (dy > half_h + 1.0f)
+      continue;
+    float half_w = std::max(0.0f, hex_size - dy * inv_sqrt3);
+    int lo = std::max(x0, (int)std::ceil(cx - half_w) - 1);
+    int hi = std::min(x1, (int)std::floor(cx + half_w) + 1);
+    float py = (float)y + org_y;
+
+    int a = lo;
+    while (a <= hi && !inside(a, py))
+      ++a;
+    if (a > hi)
+      continue;
+    if (a == lo)
+      while (a > x0 && inside(a - 1, py))
+        --a;
+
+    int b = hi;
+    while (b > a && !inside(b, py))
+      --b;
+    if (b == hi)
+      while (b < x1 && inside(b + 1, py))
+        ++b;
+
+    spans.push_back({y, a, b});
+  }
+}
+
+void HexColumnsSoA::reserve(size_t n) {
+  q.reserve(n);
+  r.reserve(n);
+  height.reserve(n);
+  base_height.reserve(n);
+  edge_mask.reserve(n);
+  for (auto &d : edge_drop)
+    d.reserve(n);
+}
+
+void HexColumnsSoA::clear() {
+  q.clear();
+  r.clear();
+  height.clear();
+  base_height.clear();
+  edge_mask.clear();
+  for (auto &d : edge_drop)
+    d.clear();
+}
+
+void HexColumnsSoA::push_back(int col_q, int col_r, float col_height, float col_base_height) {
+  q.push_back(col_q);
+  r.push_back(col_r);
+  height.push_back(col_height);
+  base_height.push_back(col_base_height);
+  edge_mask.push_back(0);
+  for (auto &d : edge_drop)
+    d.push_back(0.0f);
+}
+
+void HexColumnsSoA::push_back(const HexColumn &col) {
+  push_back(col.q, col.r, col.height, col.base_height);
+  for (int i = 0; i < 6; ++i) {
+    edge_mask.back() |= (uint8_t)(col.visible_edges[i] << i);
+    edge_drop[i].back() = col.edge_drops[i];
+  }
+}
+
+void HexColumnsSoA::push_back(const HexColumnsSoA &src, size_t i) {
+  push_back(src.q[i], src.r[i], src.height[i], src.base_height[i]);
+  edge_mask.back() = src.edge_mask[i];
+  for (int e = 0; e < 6; ++e)
+    edge_drop[e].back() = src.edge_drop[e][i];
+}
+
+void HexColumnsSoA::append(const HexColumnsSoA &src) {
+  q.insert(q.end(), src.q.begin(), src.q.end());
+  r.insert(r.end(), src.r.begin(), src.r.end());
+  height.insert(height.end(), src.height.begin(), src.height.end());
+  base_height.insert(base_height.end(), src.base_height.begin(), src.base_height.end());
+  edge_mask.insert(edge_mask.end(), src.edge_mask.begin(), src.edge_mask.end());
+  for (int e = 0; e < 6; ++e)
+    edge_drop[e].insert(edge_drop[e].end(), src.edge_drop[e].begin(), src.edge_drop[e].end());
+}
+
+HexColumn HexColumnsSoA::operator[](size_t i) const {
+  HexColumn col;
+  col.q = q[i];
+  col.r = r[i];
+  col.height = height[i];
+  col.base_height = base_height[i];
+  for (int e = 0; e < 6; ++e) {
+    col.visible_edges[e] = edge_visible(i, e);
+    col.edge_drops[e] = edge_drop[e][i];
+  }
+  return col;
+}
+
+std::vector<HexColumn> HexColumnsSoA::to_aos() const {
+  std::vector<HexColumn> out(size());
+  for (size_t i = 0; i < out.size(); ++i)
+    out[i] = (*this)[i];
+  return out;
+}
+
+HexGrid::HexGrid(const HexColumnsSoA &columns) {
+  if (columns.empty())
+    return;
+  auto [q_lo, q_hi] = std::minmax_element(columns.q.begin(), columns.q.end());
+  auto [r_lo, r_hi] = std::minmax_element(columns.r.begin(), columns.r.end());
+  min_q = *q_lo;
+  min_r = *r_lo;
+  width = *q_hi - min_q + 1;
+  height = *r_hi - min_r + 1;
+  cells.assign((size_t)width * height, -1);
+  for (size_t i = 0; i < columns.size(); ++i)
+    cells[cell(columns.q[i], columns.r[i])] = (int32_t)i;
+}
+
+void compute_visible_edges(HexColumnsSoA &columns) {
+  const HexGrid grid(columns);
+  const size_t n = columns.size();
+  columns.edge_mask.assign(n, 0);
+
+  // One direction at a time: gather the neighbour heights (zero for a
+  // missing neighbour), then the drop and mask arithmetic runs over
+  // contiguous arrays.
+  std::vector<float> nb_height(n);
+  std::vector<uint8_t> nb_missing(n);
+  for (int e = 0; e < 6; ++e) {
+    for (size_t i = 0; i < n; ++i) {
+      int32_t nb = grid.neighbor(columns.q[i], columns.r[i], e);
+      nb_missing[i] = nb < 0;
+      nb_height[i] = nb < 0 ? 0.0f : columns.height[nb];
+    }
+    const float *h = columns.height.data();
+    const float *nh = nb_height.data();
+    const uint8_t *missing = nb_missing.data();
+    float *drop = columns.edge_drop[e].data();
+    uint8_t *mask = columns.edge_mask.data();
+    for (size_t i = 0; i < n; ++i) {
+      float diff = h[i] - nh[i];
+      bool visible = missing[i] | (diff > HEX_MIN_WALL_DROP);
+      drop[i] = visible ? diff : 0.0f;
+      mask[i] |= (uint8_t)(visible << e);
     }
   }
 }
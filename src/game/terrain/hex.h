@@ -6,6 +6,8 @@
 
 inline constexpr float HEX_MIN_WALL_DROP = 1e-4f;
 
+// One column as a plain record; HexColumnsSoA is the storage, this is its
+// per-column view.
 struct HexColumn {
   int q, r;
   float height;
@@ -14,6 +16,33 @@ struct HexColumn {
   float edge_drops[6];
 };
 
+// Basalt columns stored field by field, so passes that only read positions
+// or heights stream just those arrays. Bit i of edge_mask is set when edge i
+// (facing HEX_NEIGHBORS[i]) needs a wall; edge_drop[i] is how far that wall
+// falls, zero where the edge is hidden.
+struct HexColumnsSoA {
+  std::vector<int32_t> q, r;
+  std::vector<float> height, base_height;
+  std::vector<uint8_t> edge_mask;
+  std::vector<float> edge_drop[6];
+
+  size_t size() const { return q.size(); }
+  bool empty() const { return q.empty(); }
+  bool edge_visible(size_t i, int edge) const { return (edge_mask[i] >> edge) & 1; }
+
+  void reserve(size_t n);
+  void clear();
+  // Appends a column with no visible edges; see compute_visible_edges.
+  void push_back(int col_q, int col_r, float col_height, float col_base_height);
+  void push_back(const HexColumn &col);
+  void push_back(const HexColumnsSoA &src, size_t i);
+  void append(const HexColumnsSoA &src);
+
+  // Record view of column i, for code that wants whole columns.
+  HexColumn operator[](size_t i) const;
+  std::vector<HexColumn> to_aos() const;
+};
+
 struct HexCoord {
   int q, r;
   bool operator==(const HexCoord &o) const { return q == o.q && r == o.r; }
@@ -27,4 +56,46 @@ void hex_to_pixel(int q, int r, float hex_size, float &out_x, float &out_y);
 HexCoord pixel_to_hex(float x, float y, float hex_size);
 void get_hex_corners(int q, int r, float hex_size, Vec2 corners[6]);
 bool pixel_in_hex(float px, float py, int q, int r, float hex_size);
-void compute_visible_edges(std::vector<HexColumn> &columns);
+
+// One row of a rasterized hex: pixels x0..x1 inclusive.
+struct HexSpan {
+  int y, x0, x1;
+};
+
+// Replaces `spans` with the raster rows covered by hex (q, r). Pixel (x, y)
+// is covered iff pixel_in_hex(x + org_x, y + org_y, q, r, hex_size), clipped
+// to a width x height raster. Spans come from the hex's analytic row extent
+// and only the pixels at each end are tested against the edges.
+void rasterize_hex(int q, int r, float hex_size, float org_x, float org_y, int width,
+                   int height, std::vector<HexSpan> &spans);
+
+// Axial offsets of the six neighbours; edge i of a column faces neighbour i.
+inline constexpr int HEX_NEIGHBORS[6][2] = {{1, 0}, {0, 1}, {-1, 1}, {-1, 0}, {0, -1}, {1, -1}};
+
+// Sets edge_mask/edge_drop: an edge is walled when the neighbour is missing
+// (the wall drops the full height) or lower by more than HEX_MIN_WALL_DROP.
+void compute_visible_edges(HexColumnsSoA &columns);
+
+// Dense index of columns over their axial bounding box: one entry per
+// (q, r) cell holding the column's index, or -1 where there is none.
+// Cell (q, r) sits at (r - min_r) * width + (q - min_q), so the grid is also
+// a HexAxial-connected class image.
+struct HexGrid {
+  int min_q = 0, min_r = 0;
+  int width = 0, height = 0;
+  std::vector<int32_t> cells;
+
+  HexGrid() = default;
+  explicit HexGrid(const HexColumnsSoA &columns);
+
+  bool contains(int q, int r) const {
+    return q >= min_q && r >= min_r && q < min_q + width && r < min_r + height;
+  }
+  size_t cell(int q, int r) const {
+    return (size_t)(r - min_r) * width + (q - min_q);
+  }
+  int32_t at(int q, int r) const { return contains(q, r) ? cells[cell(q, r)] : -1; }
+  int32_t neighbor(int q, int r, int dir) const {
+    return at(q + HEX_NEIGHBORS[dir][0], r + HEX_NEIGHBORS[dir][1]);
+  }
+};
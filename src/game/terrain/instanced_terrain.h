@@ -4,19 +4,18 @@
 #include <vector>
 #include <cstdint>
 
-struct HexColumn;
-struct TerrainState;
+struct HexColumnsSoA;
 
+// Instance i is column i; its color comes from the renderer's per-column
+// color buffer, so palette changes do not rebuild instances.
 struct ColumnInstance {
     glm::mat4 model;
-    float color_r, color_g, color_b, color_a;
 };
-static_assert(sizeof(ColumnInstance) == 80, "ColumnInstance must be 80 bytes");
+static_assert(sizeof(ColumnInstance) == 64, "ColumnInstance must be 64 bytes");
 
 class InstancedTerrain {
 public:
-    void build_instances(const std::vector<HexColumn> &columns,
-                         const TerrainState &terrain);
+    void build_instances(const HexColumnsSoA &columns);
     void upload(SDL_GPUDevice *device);
     void cleanup(SDL_GPUDevice *device);
 
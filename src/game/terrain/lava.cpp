@@ -1,92 +1,179 @@
 #include "terrain/lava.h"
 #include "terrain/basalt.h"
+#include "terrain/components.h"
 #include "terrain/map_data.h"
 #include "config.h"
 #include "terrain/util.h"
+#include "core/task_system.h"
 #include <SDL3/SDL.h>
 #include <algorithm>
 #include <cmath>
 #include <cstdint>
-#include <queue>
 #include <random>
-#include <unordered_set>
 #include <vector>
 
-static void generate_lava_grid_mesh(LavaBody &lava, int width, int height, float grid_spacing) {
-  lava.mesh.vertices.clear();
-  lava.mesh.indices.clear();
+// Meshes a body on a lattice of samples grid_spacing apart. Fully covered
+// cells are merged into rectangles of up to MAX_QUAD_CELLS a side (small
+// enough that the vertex-shader waves still have vertices to move). Partly
+// covered cells get their marching-squares polygon, cut at edge midpoints.
+// Vertices are shared, and each rectangle's outline includes every vertex
+// its neighbours put on its sides, so the surface has no cracks or
+// T-junctions.
+static void generate_lava_mesh(LavaBody &lava, int width, int height, float grid_spacing) {
+  constexpr int MAX_QUAD_CELLS = 16;
 
-  if (lava.pixels.empty()) return;
+  LavaMesh &mesh = lava.mesh;
+  mesh.vertices.clear();
+  mesh.indices.clear();
 
-  int nx = (int)std::ceil((lava.max_x - lava.min_x) / grid_spacing) + 1;
-  int ny = (int)std::ceil((lava.max_y - lava.min_y) / grid_spacing) + 1;
+  if (lava.mask.area == 0) return;
 
-  constexpr int MAX_LAVA_GRID_CELLS = 200 * 200;
-  if (nx * ny > MAX_LAVA_GRID_CELLS) return;
+  const int nx = (int)std::ceil((lava.max_x - lava.min_x) / grid_spacing) + 1;
+  const int ny = (int)std::ceil((lava.max_y - lava.min_y) / grid_spacing) + 1;
+  mesh.grid_width = nx;
+  mesh.grid_height = ny;
 
-  if (lava.pixel_set.empty()) {
-    for (int idx : lava.pixels) lava.pixel_set.insert(idx);
-  }
-
-  auto is_lava = [&](float x, float y) {
-    int ix = (int)std::round(x);
-    int iy = (int)std::round(y);
-    if (ix < 0 || ix >= width || iy < 0 || iy >= height) return false;
-    return lava.pixel_set.count(iy * width + ix) > 0;
-  };
-
-  std::vector<int> vertex_map(nx * ny, -1);
+  auto px = [&](int i) { return lava.min_x + i * grid_spacing; };
+  auto py = [&](int j) { return lava.min_y + j * grid_spacing; };
 
+  std::vector<uint8_t> inside((size_t)nx * ny);
   for (int j = 0; j < ny; ++j) {
     for (int i = 0; i < nx; ++i) {
-      float wx = lava.min_x + i * grid_spacing;
-      float wy = lava.min_y + j * grid_spacing;
+      int ix = (int)std::round(px(i));
+      int iy = (int)std::round(py(j));
+      inside[(size_t)j * nx + i] =
+          ix >= 0 && ix < width && iy >= 0 && iy < height && lava.mask.contains(ix, iy);
+    }
+  }
+  auto in = [&](int i, int j) { return inside[(size_t)j * nx + i] != 0; };
+
+  // Vertex ids: lattice points, then midpoints of the +x and +y lattice
+  // edges leaving each point.
+  std::vector<int32_t> point_id((size_t)nx * ny, -1);
+  std::vector<int32_t> mid_x_id((size_t)nx * ny, -1);
+  std::vector<int32_t> mid_y_id((size_t)nx * ny, -1);
+  auto add_vertex = [&](float x, float y) {
+    mesh.vertices.push_back({x, y, lava.height});
+    return (uint32_t)(mesh.vertices.size() - 1);
+  };
+  auto point = [&](int i, int j) {
+    int32_t &id = point_id[(size_t)j * nx + i];
+    if (id < 0) id = (int32_t)add_vertex(px(i), py(j));
+    return (uint32_t)id;
+  };
+  auto mid_x = [&](int i, int j) {
+    int32_t &id = mid_x_id[(size_t)j * nx + i];
+    if (id < 0) id = (int32_t)add_vertex(px(i) + 0.5f * grid_spacing, py(j));
+    return (uint32_t)id;
+  };
+  auto mid_y = [&](int i, int j) {
+    int32_t &id = mid_y_id[(size_t)j * nx + i];
+    if (id < 0) id = (int32_t)add_vertex(px(i), py(j) + 0.5f * grid_spacing);
+    return (uint32_t)id;
+  };
 
-      if (is_lava(wx, wy)) {
-        vertex_map[j * nx + i] = (int)lava.mesh.vertices.size();
-        lava.mesh.vertices.push_back({wx, wy, lava.height});
+  // Fully covered cells, greedily merged into rectangles.
+  struct Rect { int i, j, w, h; };
+  std::vector<Rect> rects;
+  const int cx = nx - 1, cy = ny - 1;
+  std::vector<uint8_t> merged((size_t)std::max(0, cx * cy));
+  auto full = [&](int i, int j) {
+    return in(i, j) && in(i + 1, j) && in(i, j + 1) && in(i + 1, j + 1);
+  };
+  auto open_cell = [&](int i, int j) { return !merged[(size_t)j * cx + i] && full(i, j); };
+  for (int j = 0; j < cy; ++j) {
+    for (int i = 0; i < cx; ++i) {
+      if (!open_cell(i, j)) continue;
+      int w = 1;
+      while (i + w < cx && w < MAX_QUAD_CELLS && open_cell(i + w, j)) ++w;
+      int h = 1;
+      while (j + h < cy && h < MAX_QUAD_CELLS) {
+        bool row_ok = true;
+        for (int k = 0; k < w && row_ok; ++k) row_ok = open_cell(i + k, j + h);
+        if (!row_ok) break;
+        ++h;
       }
+      for (int v = 0; v < h; ++v)
+        std::fill_n(merged.begin() + (size_t)(j + v) * cx + i, w, 1);
+      rects.push_back({i, j, w, h});
     }
   }
 
-  for (int j = 0; j < ny - 1; ++j) {
-    for (int i = 0; i < nx - 1; ++i) {
-      int i00 = vertex_map[j * nx + i];
-      int i10 = vertex_map[j * nx + (i + 1)];
-      int i01 = vertex_map[(j + 1) * nx + i];
-      int i11 = vertex_map[(j + 1) * nx + (i + 1)];
-
-      if (i00 != -1 && i10 != -1 && i01 != -1) {
-        lava.mesh.indices.push_back(i00);
-        lava.mesh.indices.push_back(i10);
-        lava.mesh.indices.push_back(i01);
+  // Partly covered cells: walk the corners in the same winding as the
+  // rectangles, keeping inside corners and the midpoints of edges that
+  // cross the boundary. Every such polygon is convex, so a fan suffices.
+  std::vector<uint32_t> outline;
+  for (int j = 0; j < cy; ++j) {
+    for (int i = 0; i < cx; ++i) {
+      bool c[4] = {in(i, j), in(i + 1, j), in(i + 1, j + 1), in(i, j + 1)};
+      int count = c[0] + c[1] + c[2] + c[3];
+      if (count == 0 || count == 4) continue;
+
+      const int ci[4] = {i, i + 1, i + 1, i};
+      const int cj[4] = {j, j, j + 1, j + 1};
+      outline.clear();
+      for (int k = 0; k < 4; ++k) {
+        if (c[k]) outline.push_back(point(ci[k], cj[k]));
+        if (c[k] != c[(k + 1) % 4]) {
+          switch (k) {
+          case 0: outline.push_back(mid_x(i, j)); break;
+          case 1: outline.push_back(mid_y(i + 1, j)); break;
+          case 2: outline.push_back(mid_x(i, j + 1)); break;
+          case 3: outline.push_back(mid_y(i, j)); break;
+          }
+        }
       }
-      if (i10 != -1 && i11 != -1 && i01 != -1) {
-        lava.mesh.indices.push_back(i10);
-        lava.mesh.indices.push_back(i11);
-        lava.mesh.indices.push_back(i01);
+      for (size_t k = 1; k + 1 < outline.size(); ++k) {
+        mesh.indices.push_back(outline[0]);
+        mesh.indices.push_back(outline[k]);
+        mesh.indices.push_back(outline[k + 1]);
       }
     }
   }
 
-  lava.pixel_set.clear();
-  { std::unordered_set<int> empty; lava.pixel_set.swap(empty); }
+  // Rectangle corners are vertices too. A lattice point on a rectangle's
+  // side only has to be on its outline if a neighbour already uses it.
+  for (const Rect &r : rects) {
+    point(r.i, r.j);
+    point(r.i + r.w, r.j);
+    point(r.i + r.w, r.j + r.h);
+    point(r.i, r.j + r.h);
+  }
+  auto used = [&](int i, int j) { return point_id[(size_t)j * nx + i] >= 0; };
+  for (const Rect &r : rects) {
+    outline.clear();
+    for (int k = 0; k < r.w; ++k)
+      if (used(r.i + k, r.j)) outline.push_back(point(r.i + k, r.j));
+    for (int k = 0; k < r.h; ++k)
+      if (used(r.i + r.w, r.j + k)) outline.push_back(point(r.i + r.w, r.j + k));
+    for (int k = r.w; k > 0; --k)
+      if (used(r.i + k, r.j + r.h)) outline.push_back(point(r.i + k, r.j + r.h));
+    for (int k = r.h; k > 0; --k)
+      if (used(r.i, r.j + k)) outline.push_back(point(r.i, r.j + k));
+
+    if (outline.size() == 4) {
+      const uint32_t quad[6] = {outline[0], outline[1], outline[2],
+                                outline[0], outline[2], outline[3]};
+      mesh.indices.insert(mesh.indices.end(), quad, quad + 6);
+      continue;
+    }
+    uint32_t centre = add_vertex(px(r.i) + 0.5f * r.w * grid_spacing,
+                                 py(r.j) + 0.5f * r.h * grid_spacing);
+    for (size_t k = 0; k < outline.size(); ++k) {
+      mesh.indices.push_back(centre);
+      mesh.indices.push_back(outline[k]);
+      mesh.indices.push_back(outline[(k + 1) % outline.size()]);
+    }
+  }
 }
 
-FloodFillResult generate_lava_and_void(MapData &data, float void_chance, int seed) {
+FloodFillResult generate_lava_and_void(MapData &data, float void_chance, int seed,
+                                       TaskSystem *tasks) {
   int width = data.width;
   int height = data.height;
-  int n = width * height;
 
-  std::vector<bool> visited(n, false);
   FloodFillResult result;
 
-  const int dirs[4][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
-
-  constexpr int MAX_COMPONENT_PIXELS = 50'000;
-  constexpr int TOTAL_PIXEL_BUDGET = 200'000;
-  int total_pixels_used = 0;
-
   uint32_t rng_seed = 0xDEADBEEFu;
   rng_seed ^= (uint32_t)width + 0x9e3779b9u + (rng_seed << 6) + (rng_seed >> 2);
   rng_seed ^= (uint32_t)height + 0x9e3779b9u + (rng_seed << 6) + (rng_seed >> 2);
@@ -94,110 +181,76 @@ FloodFillResult generate_lava_and_void(MapData &data, float void_chance, int see
   std::mt19937 rng(rng_seed);
   std::uniform_real_distribution<float> dist(0.0f, 1.0f);
 
-  int body_index = 0;
-  bool budget_exceeded = false;
-
-  for (int sy = 0; sy < height && !budget_exceeded; ++sy) {
-    for (int sx = 0; sx < width && !budget_exceeded; ++sx) {
-      int start = sy * width + sx;
-      if (visited[start] || data.terrain_map[start] == TERRAIN_BASALT)
-        continue;
-
-      std::vector<int> component_pixels;
-      component_pixels.reserve(std::min(MAX_COMPONENT_PIXELS, TOTAL_PIXEL_BUDGET - total_pixels_used));
-      std::queue<int> q;
-      q.push(start);
-      visited[start] = true;
-
-      float mn_x = (float)sx, mx_x = (float)sx;
-      float mn_y = (float)sy, mx_y = (float)sy;
-
-      bool capped = false;
-      while (!q.empty()) {
-        int idx = q.front();
-        q.pop();
-        component_pixels.push_back(idx);
-
-        if ((int)component_pixels.size() >= MAX_COMPONENT_PIXELS) {
-          capped = true;
-          break;
-        }
-
-        int cx = idx % width, cy = idx / width;
-
-        mn_x = std::min(mn_x, (float)cx);
-        mx_x = std::max(mx_x, (float)cx);
-        mn_y = std::min(mn_y, (float)cy);
-        mx_y = std::max(mx_y, (float)cy);
-
-        for (auto [dx, dy] : dirs) {
-          int nx = cx + dx, ny = cy + dy;
-          if (nx >= 0 && nx < width && ny >= 0 && ny < height) {
-            int nidx = ny * width + nx;
-            if (!visited[nidx] && data.terrain_map[nidx] != TERRAIN_BASALT) {
-              visited[nidx] = true;
-              q.push(nidx);
-            }
-          }
-        }
-      }
-
-      if (capped) {
-        while (!q.empty()) {
-          visited[q.front()] = true;
-          q.pop();
-        }
-        continue;
-      }
-
-      if (component_pixels.size() < 50)
-        continue;
-
-      if (total_pixels_used + (int)component_pixels.size() > TOTAL_PIXEL_BUDGET) {
-        SDL_Log("generate_lava_and_void: pixel budget exhausted (%d used, component %zu would exceed %d)",
-                total_pixels_used, component_pixels.size(), TOTAL_PIXEL_BUDGET);
-        budget_exceeded = true;
-        continue;
-      }
-
-      bool is_void = dist(rng) < void_chance;
-      int16_t terrain_type = is_void ? TERRAIN_VOID : TERRAIN_LAVA;
-
-      LavaBody body;
-      body.plateau_index = -1;
-      body.height = 0.0f;
-      body.min_x = mn_x;
-      body.max_x = mx_x;
-      body.min_y = mn_y;
-      body.max_y = mx_y;
-      float bw = mx_x - mn_x + 1.f, bh = mx_y - mn_y + 1.f;
-      body.aspect_ratio = std::max(bw, bh) / std::max(1.0f, std::min(bw, bh));
-      body.pixels = std::move(component_pixels);
-      body.time_offset =
-          (hash1d(body_index++) % 1000) / 1000.0f * 6.283185f;
-
-      if (!is_void) {
-        generate_lava_grid_mesh(body, width, height, 2.0f);
-      }
+  const int16_t *terrain = data.terrain_map.data();
+  ComponentRuns comps = label_component_runs(
+      width, height,
+      [&](int y, int32_t *row) {
+        const int16_t *src = terrain + (size_t)y * width;
+        for (int x = 0; x < width; ++x)
+          row[x] = src[x] == TERRAIN_BASALT ? -1 : 0;
+      },
+      Connectivity::Four, tasks);
+
+  // Components come in the order of their first pixel.
+  std::vector<int32_t> body_of(comps.count(), -1);
+  std::vector<int32_t> chosen;
+  int64_t total_pixels_used = 0;
+  for (int c = 0; c < comps.count(); ++c) {
+    int area = comps.components[c].area;
+    if (area < LAVA_MIN_BODY_PIXELS)
+      continue;
+    body_of[c] = (int32_t)chosen.size();
+    chosen.push_back(c);
+    total_pixels_used += area;
+  }
 
-      for (int idx : body.pixels) {
-        if (data.terrain_map[idx] != TERRAIN_BASALT)
-          data.terrain_map[idx] = terrain_type;
-      }
+  // Lava or void is drawn per body up front so terrain_map and the masks
+  // are filled in one pass over the runs.
+  std::vector<LavaBody> bodies(chosen.size());
+  std::vector<uint8_t> body_is_void(chosen.size());
+  for (size_t b = 0; b < chosen.size(); ++b) {
+    const ComponentStats &s = comps.components[chosen[b]];
+    body_is_void[b] = dist(rng) < void_chance;
+    bodies[b].mask.reset(s.min_x, s.min_y, s.max_x, s.max_y);
+  }
+  for (const ComponentRun &r : comps.runs) {
+    int32_t b = body_of[r.label];
+    if (b < 0)
+      continue;
+    bodies[b].mask.set_span(r.y, r.x0, r.x1);
+    int16_t *row = data.terrain_map.data() + (size_t)r.y * width;
+    std::fill(row + r.x0, row + r.x1 + 1, body_is_void[b] ? TERRAIN_VOID : TERRAIN_LAVA);
+  }
 
-      total_pixels_used += (int)body.pixels.size();
+  for (size_t b = 0; b < chosen.size(); ++b) {
+    const ComponentStats &s = comps.components[chosen[b]];
+    LavaBody &body = bodies[b];
+    body.plateau_index = -1;
+    body.height = 0.0f;
+    body.min_x = (float)s.min_x;
+    body.max_x = (float)s.max_x;
+    body.min_y = (float)s.min_y;
+    body.max_y = (float)s.max_y;
+    float bw = body.max_x - body.min_x + 1.f, bh = body.max_y - body.min_y + 1.f;
+    body.aspect_ratio = std::max(bw, bh) / std::max(1.0f, std::min(bw, bh));
+    body.time_offset = (hash1d((int)b) % 1000) / 1000.0f * 6.283185f;
+  }
 
-      body.pixels.clear();
-      body.pixels.shrink_to_fit();
+  // Bodies mesh independently.
+  auto mesh_body = [&](int b) {
+    if (!body_is_void[b])
+      generate_lava_mesh(bodies[b], width, height, 2.0f);
+  };
+  TaskSystem::run(tasks, (int)bodies.size(), mesh_body);
 
-      if (is_void)
-        result.void_bodies.push_back(std::move(body));
-      else
-        result.lava_bodies.push_back(std::move(body));
-    }
+  for (size_t b = 0; b < bodies.size(); ++b) {
+    if (body_is_void[b])
+      result.void_bodies.push_back(std::move(bodies[b]));
+    else
+      result.lava_bodies.push_back(std::move(bodies[b]));
   }
 
-  SDL_Log("generate_lava_and_void: %zu lava bodies, %zu void bodies, %d total pixels used",
-          result.lava_bodies.size(), result.void_bodies.size(), total_pixels_used);
+  SDL_Log("generate_lava_and_void: %zu lava bodies, %zu void bodies, %lld total pixels used",
+          result.lava_bodies.size(), result.void_bodies.size(), (long long)total_pixels_used);
   return result;
 }
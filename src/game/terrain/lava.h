@@ -1,9 +1,11 @@
 #pragma once
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
-#include <unordered_set>
 #include <vector>
 
 struct MapData;
+class TaskSystem;
 
 struct LavaVertex {
   float x, y;
@@ -18,16 +20,56 @@ struct LavaMesh {
   std::vector<uint8_t> active;
 };
 
+// A body's pixels as a bitmap over its bounding box, one bit per pixel and
+// rows padded to whole 64-bit words. Coordinates are raster pixels.
+struct PixelMask {
+  int x0 = 0, y0 = 0;
+  int width = 0, height = 0;
+  int area = 0;
+  std::vector<uint64_t> bits;
+
+  int words_per_row() const { return (width + 63) >> 6; }
+
+  void reset(int min_x, int min_y, int max_x, int max_y) {
+    x0 = min_x;
+    y0 = min_y;
+    width = max_x - min_x + 1;
+    height = max_y - min_y + 1;
+    area = 0;
+    bits.assign((size_t)words_per_row() * height, 0);
+  }
+
+  bool contains(int x, int y) const {
+    x -= x0;
+    y -= y0;
+    if ((unsigned)x >= (unsigned)width || (unsigned)y >= (unsigned)height)
+      return false;
+    return (bits[(size_t)y * words_per_row() + (x >> 6)] >> (x & 63)) & 1;
+  }
+
+  // Sets pixels x_begin..x_end (inclusive) of row y; they must lie inside
+  // the box and not be set yet.
+  void set_span(int y, int x_begin, int x_end) {
+    uint64_t *row = bits.data() + (size_t)(y - y0) * words_per_row();
+    int a = x_begin - x0, b = x_end - x0;
+    area += b - a + 1;
+    for (int w = a >> 6; w <= b >> 6; ++w) {
+      int lo = std::max(a, w << 6) & 63;
+      int hi = std::min(b, (w << 6) + 63) & 63;
+      row[w] |= (~uint64_t(0) >> (63 - hi)) & (~uint64_t(0) << lo);
+    }
+  }
+};
+
 struct LavaBody {
   int plateau_index = -1;
   float height = 0.f;
   float min_x = 0, max_x = 0;
   float min_y = 0, max_y = 0;
   float aspect_ratio = 0.f;
-  std::vector<int> pixels;
+  PixelMask mask;
   float time_offset = 0.f;
   LavaMesh mesh;
-  std::unordered_set<int> pixel_set;
 };
 
 struct FloodFillResult {
@@ -35,4 +77,11 @@ struct FloodFillResult {
   std::vector<LavaBody> void_bodies;
 };
 
-FloodFillResult generate_lava_and_void(MapData &data, float void_chance, int seed = 0);
+// Turns every open (non-basalt) region of at least LAVA_MIN_BODY_PIXELS
+// into a lava or void body and marks it in terrain_map. Regions are
+// labelled as runs straight from terrain_map, so there is no size limit and
+// no per-pixel label image.
+inline constexpr int LAVA_MIN_BODY_PIXELS = 50;
+
+FloodFillResult generate_lava_and_void(MapData &data, float void_chance, int seed = 0,
+                                       TaskSystem *tasks = nullptr);
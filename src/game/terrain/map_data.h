@@ -1,10 +1,19 @@
 #pragma once
+#include "config.h"
 #include "terrain/contour.h"
 #include "terrain/hex.h"
 #include "terrain/lava.h"
 #include <cstdint>
+#include <memory>
 #include <vector>
 
+// Generated layers are immutable: noise layers may be shared with
+// NoiseCache, and the rasters compose_layers derives from them are shared by
+// every later stage's copy of the map.
+using NoiseLayer = std::shared_ptr<const std::vector<float>>;
+using MaskLayer = std::shared_ptr<const std::vector<uint8_t>>;
+using NoiseIdLayer = std::shared_ptr<const std::vector<int32_t>>;
+
 constexpr int16_t TERRAIN_EMPTY  =  0;
 constexpr int16_t TERRAIN_BASALT = -1;
 constexpr int16_t TERRAIN_LAVA   = -2;
@@ -13,41 +22,48 @@ constexpr int16_t TERRAIN_VOID   = -3;
 struct MapData {
   int width = 0;
   int height = 0;
+  // Raster pixels per world unit; lower for coarse preview maps.
+  float pixels_per_unit = Config::HEX_SIZE;
+  // World pixel of this raster's (0, 0); non-zero for world chunks.
+  int origin_x = 0;
+  int origin_y = 0;
 
-  std::vector<float> elevation;
-  std::vector<float> river_mask;
-  std::vector<float> worley;
-  std::vector<float> worley_edge;
-  std::vector<float> worley_cell_value;
+  NoiseLayer elevation;
+  NoiseLayer river_mask;
+  NoiseLayer worley;
+  NoiseLayer worley_edge;
+  NoiseLayer worley_cell_value;
+  NoiseIdLayer worley_cell_id;
 
-  std::vector<float> final_elevation;
-  std::vector<uint8_t> liquid_mask;
-  std::vector<float> basalt_height;
+  NoiseLayer final_elevation;
+  MaskLayer liquid_mask;
+  NoiseLayer basalt_height;
 
-  std::vector<HexColumn> columns;
+  HexColumnsSoA columns;
   std::vector<int16_t> terrain_map;
   std::vector<LavaBody> lava_bodies;
   std::vector<LavaBody> void_bodies;
-  std::vector<Line> contour_lines;
+  ContourStrips contour_strips;
   std::vector<int> band_map;
 
   void allocate(int w, int h) {
     width = w;
     height = h;
     int n = w * h;
-    elevation.resize(n);
-    river_mask.resize(n);
-    worley.resize(n);
-    worley_edge.resize(n);
-    worley_cell_value.resize(n);
-    final_elevation.resize(n);
-    liquid_mask.resize(n);
-    basalt_height.resize(n);
+    elevation.reset();
+    river_mask.reset();
+    worley.reset();
+    worley_edge.reset();
+    worley_cell_value.reset();
+    worley_cell_id.reset();
+    final_elevation.reset();
+    liquid_mask = std::make_shared<const std::vector<uint8_t>>(n, 0);
+    basalt_height.reset();
     terrain_map.assign(n, 0);
     columns.clear();
     lava_bodies.clear();
     void_bodies.clear();
-    contour_lines.clear();
-    band_map.resize(n);
+    contour_strips.clear();
+    band_map.clear();
   }
 };
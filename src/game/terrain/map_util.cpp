@@ -1,16 +1,17 @@
 #include "terrain/map_util.h"
+#include "terrain/components.h"
 #include "config.h"
 #include <algorithm>
 #include <random>
-#include <unordered_map>
 #include <vector>
 #include <cmath>
 
 float sample_world_height(const MapData &map, float wx, float wy) {
-    if (map.basalt_height.empty()) return 0.0f;
+    if (!map.basalt_height || map.basalt_height->empty()) return 0.0f;
+    const std::vector<float> &heights = *map.basalt_height;
 
-    float px = wx * Config::HEX_SIZE;
-    float py = wy * Config::HEX_SIZE;
+    float px = wx * map.pixels_per_unit;
+    float py = wy * map.pixels_per_unit;
 
     int x0 = (int)px;
     int y0 = (int)py;
@@ -25,10 +26,10 @@ float sample_world_height(const MapData &map, float wx, float wy) {
     float tx = px - (int)px;
     float ty = py - (int)py;
 
-    float v00 = map.basalt_height[y0 * map.width + x0];
-    float v10 = map.basalt_height[y0 * map.width + x1];
-    float v01 = map.basalt_height[y1 * map.width + x0];
-    float v11 = map.basalt_height[y1 * map.width + x1];
+    float v00 = heights[y0 * map.width + x0];
+    float v10 = heights[y0 * map.width + x1];
+    float v01 = heights[y1 * map.width + x0];
+    float v11 = heights[y1 * map.width + x1];
 
     float top    = v00 + (v10 - v00) * tx;
     float bottom = v01 + (v11 - v01) * tx;
@@ -64,60 +65,46 @@ glm::vec3 sample_terrain_normal(const MapData &map, float wx, float wy) {
 HexColumn find_spawn_column(const MapData &map, uint32_t seed) {
     if (map.columns.empty()) return HexColumn{};
 
-    std::unordered_map<HexCoord, const HexColumn *, HexHash> lookup;
-    lookup.reserve(map.columns.size());
-    for (const auto &col : map.columns)
-        lookup[{col.q, col.r}] = &col;
-
-    static const int dx[6] = { 1,  0, -1, -1,  0,  1};
-    static const int dy[6] = { 0,  1,  1,  0, -1, -1};
-
-    std::vector<bool> visited(map.columns.size(), false);
-
-    std::unordered_map<HexCoord, size_t, HexHash> col_index;
-    col_index.reserve(map.columns.size());
-    for (size_t i = 0; i < map.columns.size(); ++i)
-        col_index[{map.columns[i].q, map.columns[i].r}] = i;
-
-    size_t best_start = 0;
-    size_t best_size  = 0;
-    std::vector<size_t> best_component;
-
-    std::vector<size_t> queue;
-    queue.reserve(256);
-
-    for (size_t start = 0; start < map.columns.size(); ++start) {
-        if (visited[start]) continue;
-
-        queue.clear();
-        queue.push_back(start);
-        visited[start] = true;
-        std::vector<size_t> component;
-
-        for (size_t qi = 0; qi < queue.size(); ++qi) {
-            size_t cur = queue[qi];
-            component.push_back(cur);
-            const HexColumn &c = map.columns[cur];
-            for (int d = 0; d < 6; ++d) {
-                HexCoord nb{c.q + dx[d], c.r + dy[d]};
-                auto it = col_index.find(nb);
-                if (it == col_index.end()) continue;
-                size_t ni = it->second;
-                if (!visited[ni]) {
-                    visited[ni] = true;
-                    queue.push_back(ni);
-                }
-            }
+    // The column grid doubles as the occupancy image; hex neighbours are its
+    // HexAxial connectivity.
+    HexGrid grid(map.columns);
+    std::vector<int32_t> occupied(grid.cells.size());
+    for (size_t i = 0; i < occupied.size(); ++i)
+        occupied[i] = grid.cells[i] >= 0 ? 0 : -1;
+    ComponentLabels comps = label_components(occupied, grid.width, grid.height,
+                                             Connectivity::HexAxial);
+    auto label_of = [&](size_t i) {
+        return comps.labels[grid.cell(map.columns.q[i], map.columns.r[i])];
+    };
+
+    // Largest component; ties go to the one reached first in column order.
+    int32_t best = -1;
+    size_t best_first = 0;
+    for (size_t i = 0; i < map.columns.size(); ++i) {
+        int32_t c = label_of(i);
+        if (best < 0 || comps.components[c].area > comps.components[best].area) {
+            best = c;
+            best_first = i;
         }
+    }
 
-        if (component.size() > best_size) {
-            best_size      = component.size();
-            best_component = std::move(component);
+    // Walk it breadth-first from its first column, in HEX_NEIGHBORS order, so
+    // a seed draws the same column it did before the labeller was shared.
+    std::vector<size_t> best_component;
+    best_component.reserve(comps.components[best].area);
+    std::vector<bool> visited(map.columns.size(), false);
+    best_component.push_back(best_first);
+    visited[best_first] = true;
+    for (size_t qi = 0; qi < best_component.size(); ++qi) {
+        size_t cur = best_component[qi];
+        for (int d = 0; d < 6; ++d) {
+            int32_t ni = grid.neighbor(map.columns.q[cur], map.columns.r[cur], d);
+            if (ni < 0 || visited[ni]) continue;
+            visited[ni] = true;
+            best_component.push_back((size_t)ni);
         }
     }
 
-    if (best_component.empty()) return map.columns[0];
-
     std::mt19937 rng(seed);
     std::uniform_int_distribution<size_t> dist(0, best_component.size() - 1);
     return map.columns[best_component[dist(rng)]];
@@ -0,0 +1,350 @@
+#include "terrain/noise_cache.h"
+#include <SDL3/SDL.h>
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+
+namespace {
+
+struct DiskHeader {
+  char magic[4];
+  uint32_t version;
+  uint32_t slot;
+  uint32_t reserved;
+  uint64_t param_hash;
+  uint64_t counts[4];  // data, data2, data3, ids
+};
+
+constexpr char DISK_MAGIC[4] = {'D', 'N', 'C', 'L'};
+
+template <typename T>
+size_t layer_bytes(const std::shared_ptr<const std::vector<T>> &layer) {
+  return layer ? layer->size() * sizeof(T) : 0;
+}
+
+template <typename T>
+bool read_layer(std::ifstream &in, uint64_t count,
+                std::shared_ptr<const std::vector<T>> &out) {
+  if (count == 0)
+    return true;
+  std::vector<T> v(count);
+  if (!in.read(reinterpret_cast<char *>(v.data()), (std::streamsize)(count * sizeof(T))))
+    return false;
+  out = std::make_shared<const std::vector<T>>(std::move(v));
+  return true;
+}
+
+template <typename T>
+void write_layer(std::ofstream &out, const std::shared_ptr<const std::vector<T>> &layer) {
+  if (layer)
+    out.write(reinterpret_cast<const char *>(layer->data()),
+              (std::streamsize)(layer->size() * sizeof(T)));
+}
+
+} // namespace
+
+bool NoiseCache::get(Slot slot, uint64_t param_hash, NoiseLayer &out) {
+  CacheEntry e;
+  if (!lookup(slot, param_hash, e))
+    return false;
+  out = std::move(e.data);
+  return true;
+}
+
+bool NoiseCache::get3(Slot slot, uint64_t param_hash, NoiseLayer &out1,
+                      NoiseLayer &out2, NoiseLayer &out3, NoiseIdLayer *out_ids) {
+  CacheEntry e;
+  if (!lookup(slot, param_hash, e))
+    return false;
+  out1 = std::move(e.data);
+  out2 = std::move(e.data2);
+  out3 = std::move(e.data3);
+  if (out_ids)
+    *out_ids = std::move(e.ids);
+  return true;
+}
+
+void NoiseCache::put3(Slot slot, uint64_t param_hash, NoiseLayer data1,
+                      NoiseLayer data2, NoiseLayer data3, NoiseIdLayer ids) {
+  CacheEntry e;
+  e.slot = slot;
+  e.param_hash = param_hash;
+  e.bytes = layer_bytes(data1) + layer_bytes(data2) + layer_bytes(data3) +
+            layer_bytes(ids);
+  e.data = std::move(data1);
+  e.data2 = std::move(data2);
+  e.data3 = std::move(data3);
+  e.ids = std::move(ids);
+
+  queue_disk_write(e);
+  insert(std::move(e));
+}
+
+NoiseCache::~NoiseCache() {
+  {
+    std::lock_guard<std::mutex> lk(mtx);
+    disk_stop = true;
+  }
+  disk_cv.notify_all();
+  if (disk_writer.joinable())
+    disk_writer.join();
+}
+
+void NoiseCache::set_byte_budget(size_t bytes) {
+  std::lock_guard<std::mutex> lk(mtx);
+  byte_budget = bytes;
+  enforce_budget();
+}
+
+void NoiseCache::set_disk_dir(std::string dir) {
+  std::lock_guard<std::mutex> lk(mtx);
+  disk_dir = std::move(dir);
+}
+
+void NoiseCache::set_disk_budget(size_t bytes) {
+  std::lock_guard<std::mutex> lk(mtx);
+  disk_budget = bytes;
+}
+
+void NoiseCache::flush_disk() {
+  std::unique_lock<std::mutex> lk(mtx);
+  disk_cv.wait(lk, [&] { return disk_queue.empty() && !disk_writing; });
+}
+
+void NoiseCache::invalidate_all() {
+  std::lock_guard<std::mutex> lk(mtx);
+  lru.clear();
+  total_bytes = 0;
+}
+
+NoiseCache::Stats NoiseCache::stats() const {
+  std::lock_guard<std::mutex> lk(mtx);
+  Stats s = counters;
+  s.entries = lru.size();
+  s.bytes = total_bytes;
+  return s;
+}
+
+bool NoiseCache::lookup(Slot slot, uint64_t param_hash, CacheEntry &out) {
+  {
+    std::lock_guard<std::mutex> lk(mtx);
+    for (auto it = lru.begin(); it != lru.end(); ++it) {
+      if (it->slot == slot && it->param_hash == param_hash) {
+        lru.splice(lru.begin(), lru, it);
+        ++counters.hits;
+        out = lru.front();
+        return true;
+      }
+    }
+  }
+
+  // File reads happen outside the lock; a racing put of the same key just
+  // replaces the entry.
+  if (disk_load(slot, param_hash, out)) {
+    std::lock_guard<std::mutex> lk(mtx);
+    ++counters.disk_hits;
+  } else {
+    std::lock_guard<std::mutex> lk(mtx);
+    ++counters.misses;
+    return false;
+  }
+  insert(out);
+  return true;
+}
+
+void NoiseCache::insert(CacheEntry entry) {
+  std::lock_guard<std::mutex> lk(mtx);
+  for (auto it = lru.begin(); it != lru.end(); ++it) {
+    if (it->slot == entry.slot && it->param_hash == entry.param_hash) {
+      total_bytes -= it->bytes;
+      lru.erase(it);
+      break;
+    }
+  }
+  total_bytes += entry.bytes;
+  lru.push_front(std::move(entry));
+  enforce_budget();
+}
+
+void NoiseCache::enforce_budget() {
+  while (total_bytes > byte_budget && lru.size() > 1) {
+    total_bytes -= lru.back().bytes;
+    lru.pop_back();
+    ++counters.evictions;
+  }
+}
+
+std::string NoiseCache::disk_path(Slot slot, uint64_t param_hash) const {
+  std::lock_guard<std::mutex> lk(mtx);
+  if (disk_dir.empty())
+    return {};
+  char name[64];
+  std::snprintf(name, sizeof(name), "layer%d_%016" PRIx64 ".bin", (int)slot, param_hash);
+  return (std::filesystem::path(disk_dir) / name).string();
+}
+
+bool NoiseCache::disk_load(Slot slot, uint64_t param_hash, CacheEntry &out) const {
+  std::string path = disk_path(slot, param_hash);
+  if (path.empty())
+    return false;
+  std::ifstream in(path, std::ios::binary);
+  if (!in)
+    return false;
+
+  DiskHeader h;
+  if (!in.read(reinterpret_cast<char *>(&h), sizeof(h)) ||
+      std::memcmp(h.magic, DISK_MAGIC, sizeof(DISK_MAGIC)) != 0 ||
+      h.version != DISK_FORMAT_VERSION || h.slot != (uint32_t)slot ||
+      h.param_hash != param_hash)
+    return false;
+
+  CacheEntry e;
+  e.slot = slot;
+  e.param_hash = param_hash;
+  if (!read_layer(in, h.counts[0], e.data) || !read_layer(in, h.counts[1], e.data2) ||
+      !read_layer(in, h.counts[2], e.data3) || !read_layer(in, h.counts[3], e.ids)) {
+    SDL_Log("NoiseCache: truncated %s, ignoring", path.c_str());
+    return false;
+  }
+
+  // Eviction goes by modification time, so a hit marks the file as recent.
+  std::error_code ec;
+  std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec);
+  e.bytes = layer_bytes(e.data) + layer_bytes(e.data2) + layer_bytes(e.data3) +
+            layer_bytes(e.ids);
+  out = std::move(e);
+  return true;
+}
+
+bool NoiseCache::disk_store(const CacheEntry &entry) const {
+  std::string path = disk_path(entry.slot, entry.param_hash);
+  if (path.empty())
+    return false;
+
+  std::error_code ec;
+  std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+
+  DiskHeader h = {};
+  std::memcpy(h.magic, DISK_MAGIC, sizeof(DISK_MAGIC));
+  h.version = DISK_FORMAT_VERSION;
+  h.slot = (uint32_t)entry.slot;
+  h.param_hash = entry.param_hash;
+  h.counts[0] = entry.data ? entry.data->size() : 0;
+  h.counts[1] = entry.data2 ? entry.data2->size() : 0;
+  h.counts[2] = entry.data3 ? entry.data3->size() : 0;
+  h.counts[3] = entry.ids ? entry.ids->size() : 0;
+
+  // Write to a temporary name and rename, so readers never see half a file.
+  std::string tmp = path + ".tmp";
+  {
+    std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+    if (!out)
+      return false;
+    out.write(reinterpret_cast<const char *>(&h), sizeof(h));
+    write_layer(out, entry.data);
+    write_layer(out, entry.data2);
+    write_layer(out, entry.data3);
+    write_layer(out, entry.ids);
+    if (!out)
+      return false;
+  }
+  std::filesystem::rename(tmp, path, ec);
+  if (ec) {
+    SDL_Log("NoiseCache: could not write %s: %s", path.c_str(), ec.message().c_str());
+    std::filesystem::remove(tmp, ec);
+    return false;
+  }
+  return true;
+}
+
+// Layers are immutable, so the queued entry shares them with the memory tier
+// and the generating thread never waits on the file system. A key already
+// waiting in the queue is not queued again.
+void NoiseCache::queue_disk_write(const CacheEntry &entry) {
+  {
+    std::lock_guard<std::mutex> lk(mtx);
+    if (disk_dir.empty())
+      return;
+    for (const CacheEntry &q : disk_queue)
+      if (q.slot == entry.slot && q.param_hash == entry.param_hash)
+        return;
+    disk_queue.push_back(entry);
+    if (!disk_writer.joinable())
+      disk_writer = std::thread([this] { disk_writer_loop(); });
+  }
+  disk_cv.notify_all();
+}
+
+void NoiseCache::disk_writer_loop() {
+  std::unique_lock<std::mutex> lk(mtx);
+  for (;;) {
+    disk_cv.wait(lk, [&] { return disk_stop || !disk_queue.empty(); });
+    if (disk_queue.empty())
+      return;
+    CacheEntry e = std::move(disk_queue.front());
+    disk_queue.pop_front();
+    disk_writing = true;
+    lk.unlock();
+
+    bool written = disk_store(e);
+    uint64_t evicted = written ? enforce_disk_budget(disk_path(e.slot, e.param_hash)) : 0;
+
+    lk.lock();
+    if (written)
+      ++counters.disk_writes;
+    counters.disk_evictions += evicted;
+    disk_writing = false;
+    disk_cv.notify_all();
+  }
+}
+
+// Deletes the least recently used layer files until the directory fits the
+// budget. Returns the number of files removed.
+uint64_t NoiseCache::enforce_disk_budget(const std::string &keep) const {
+  namespace fs = std::filesystem;
+  std::string dir;
+  size_t budget;
+  {
+    std::lock_guard<std::mutex> lk(mtx);
+    dir = disk_dir;
+    budget = disk_budget;
+  }
+
+  struct File {
+    fs::file_time_type mtime;
+    uintmax_t size;
+    fs::path path;
+  };
+  std::vector<File> files;
+  uintmax_t total = 0;
+  std::error_code ec;
+  for (const auto &f : fs::directory_iterator(dir, ec)) {
+    std::string name = f.path().filename().string();
+    if (name.rfind("layer", 0) != 0 || f.path().extension() != ".bin")
+      continue;
+    File file{f.last_write_time(ec), f.file_size(ec), f.path()};
+    if (ec)
+      continue;
+    total += file.size;
+    files.push_back(std::move(file));
+  }
+  if (total <= budget)
+    return 0;
+
+  std::sort(files.begin(), files.end(), [](const File &a, const File &b) {
+    return a.mtime != b.mtime ? a.mtime < b.mtime : a.path < b.path;
+  });
+  uint64_t removed = 0;
+  for (const File &f : files) {
+    if (total <= budget)
+      break;
+    if (f.path == fs::path(keep) || !fs::remove(f.path, ec))
+      continue;
+    total -= f.size;
+    ++removed;
+  }
+  return removed;
+}
@@ -1,71 +1,121 @@
 #pragma once
+#include "terrain/map_data.h"
 #include <cstdint>
+#include <condition_variable>
 #include <cstring>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
 #include <vector>
 
+// LRU cache of generated noise layers, several entries per slot. Layers are
+// immutable and shared, so a hit hands MapData the cached buffers directly.
+// With a disk directory set, every put is also queued for a background
+// writer and memory misses fall back to those files, so layers survive
+// restarts. The directory is kept under its own budget by deleting the
+// least recently used files; disk hits refresh a file's modification time.
 struct NoiseCache {
   enum Slot { ELEVATION = 0, RIVER = 1, WORLEY = 2, SLOT_COUNT = 3 };
 
+  static constexpr size_t DEFAULT_BYTE_BUDGET = 256ull << 20;
+  static constexpr size_t DEFAULT_DISK_BUDGET = 1ull << 30;
+  // Bump whenever a generator's output changes so stale files are ignored.
+  static constexpr uint32_t DISK_FORMAT_VERSION = 3;
+
   struct CacheEntry {
+    Slot slot = ELEVATION;
     uint64_t param_hash = 0;
-    std::vector<float> data;
-    std::vector<float> data2;
-    std::vector<float> data3;
-    bool valid = false;
+    NoiseLayer data;
+    NoiseLayer data2;
+    NoiseLayer data3;
+    NoiseIdLayer ids;
+    size_t bytes = 0;
   };
 
-  CacheEntry entries[SLOT_COUNT];
+  struct Stats {
+    uint64_t hits = 0;
+    uint64_t disk_hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    uint64_t disk_writes = 0;
+    uint64_t disk_evictions = 0;
+    size_t entries = 0;
+    size_t bytes = 0;
+  };
 
   template <typename T> static uint64_t hash_params(const T &params) {
-    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&params);
-    uint64_t hash = 14695981039346656037ULL;
-    for (size_t i = 0; i < sizeof(T); ++i) {
-      hash ^= bytes[i];
-      hash *= 1099511628211ULL;
-    }
-    return hash;
+    return fnv1a(14695981039346656037ULL, &params, sizeof(T));
   }
 
-  bool get(Slot slot, uint64_t param_hash, std::vector<float> &out) const {
-    const auto &e = entries[slot];
-    if (e.valid && e.param_hash == param_hash) {
-      out = e.data;
-      return true;
-    }
-    return false;
+  // Entries of different raster sizes share the cache, so keys include it.
+  template <typename T>
+  static uint64_t layer_key(const T &params, int width, int height) {
+    const int32_t dims[2] = {width, height};
+    return fnv1a(hash_params(params), dims, sizeof(dims));
   }
 
-  bool get3(Slot slot, uint64_t param_hash, std::vector<float> &out1,
-            std::vector<float> &out2, std::vector<float> &out3) const {
-    const auto &e = entries[slot];
-    if (e.valid && e.param_hash == param_hash) {
-      out1 = e.data;
-      out2 = e.data2;
-      out3 = e.data3;
-      return true;
-    }
-    return false;
-  }
+  bool get(Slot slot, uint64_t param_hash, NoiseLayer &out);
+  bool get3(Slot slot, uint64_t param_hash, NoiseLayer &out1, NoiseLayer &out2,
+            NoiseLayer &out3, NoiseIdLayer *out_ids = nullptr);
 
-  void put(Slot slot, uint64_t param_hash, std::vector<float> data) {
-    auto &e = entries[slot];
-    e.param_hash = param_hash;
-    e.data = std::move(data);
-    e.valid = true;
+  void put(Slot slot, uint64_t param_hash, NoiseLayer data) {
+    put3(slot, param_hash, std::move(data), nullptr, nullptr);
   }
+  void put3(Slot slot, uint64_t param_hash, NoiseLayer data1, NoiseLayer data2,
+            NoiseLayer data3, NoiseIdLayer ids = nullptr);
 
-  void put3(Slot slot, uint64_t param_hash, std::vector<float> data1,
-            std::vector<float> data2, std::vector<float> data3) {
-    auto &e = entries[slot];
-    e.param_hash = param_hash;
-    e.data = std::move(data1);
-    e.data2 = std::move(data2);
-    e.data3 = std::move(data3);
-    e.valid = true;
-  }
+  // The newest entry is always kept, even when it alone exceeds the budget.
+  void set_byte_budget(size_t bytes);
+  // Empty disables the disk tier. The directory is created on first write.
+  void set_disk_dir(std::string dir);
+  // The newest file is always kept, even when it alone exceeds the budget.
+  void set_disk_budget(size_t bytes);
+  // Blocks until every queued disk write has finished.
+  void flush_disk();
 
-  void invalidate_all() {
-    for (auto &e : entries)
-      e.valid = false;
+  NoiseCache() = default;
+  NoiseCache(const NoiseCache &) = delete;
+  NoiseCache &operator=(const NoiseCache &) = delete;
+  ~NoiseCache();
+
+  // Drops the memory tier; files on disk are left alone.
+  void invalidate_all();
+  Stats stats() const;
+
+private:
+  static uint64_t fnv1a(uint64_t hash, const void *data, size_t size) {
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    for (size_t i = 0; i < size; ++i) {
+      hash ^= bytes[i];
+      hash *= 1099511628211ULL;
+    }
+    return hash;
   }
+
+  bool lookup(Slot slot, uint64_t param_hash, CacheEntry &out);
+  void insert(CacheEntry entry);
+  void enforce_budget();
+
+  std::string disk_path(Slot slot, uint64_t param_hash) const;
+  bool disk_load(Slot slot, uint64_t param_hash, CacheEntry &out) const;
+  bool disk_store(const CacheEntry &entry) const;
+  void queue_disk_write(const CacheEntry &entry);
+  void disk_writer_loop();
+  uint64_t enforce_disk_budget(const std::string &keep) const;
+
+  mutable std::mutex mtx;
+  std::list<CacheEntry> lru;
+  size_t total_bytes = 0;
+  size_t byte_budget = DEFAULT_BYTE_BUDGET;
+  std::string disk_dir;
+  size_t disk_budget = DEFAULT_DISK_BUDGET;
+  Stats counters;
+
+  std::condition_variable disk_cv;
+  std::deque<CacheEntry> disk_queue;
+  bool disk_writing = false;
+  bool disk_stop = false;
+  std::thread disk_writer;
 };
@@ -1,86 +1,121 @@
 #include "terrain/noise_composer.h"
+#include "terrain/components.h"
 #include "terrain/contour.h"
+#include "core/task_system.h"
 #include <SDL3/SDL.h>
 #include <algorithm>
 #include <cmath>
+#include <functional>
+#include <memory>
+#include <unordered_map>
 #include <vector>
 
-static void cleanup_small_regions(std::vector<float> &heightmap, int width,
-                                  int height, int min_region_size) {
-  int n = width * height;
-  std::vector<bool> visited(n, false);
-  std::vector<int> region_pixels;
-  region_pixels.reserve(1000);
-
-  for (int start_y = 0; start_y < height; ++start_y) {
-    for (int start_x = 0; start_x < width; ++start_x) {
-      int start_idx = start_y * width + start_x;
-      if (visited[start_idx])
-        continue;
-
-      float region_height = heightmap[start_idx];
-      region_pixels.clear();
-
-      std::vector<int> stack;
-      stack.push_back(start_idx);
-      visited[start_idx] = true;
-
-      while (!stack.empty()) {
-        int idx = stack.back();
-        stack.pop_back();
-        region_pixels.push_back(idx);
-
-        int px = idx % width;
-        int py = idx / width;
-
-        int neighbors[4][2] = {{0, -1}, {-1, 0}, {1, 0}, {0, 1}};
-        for (auto [dx, dy] : neighbors) {
-          int nx = px + dx, ny = py + dy;
-          if (nx >= 0 && nx < width && ny >= 0 && ny < height) {
-            int nidx = ny * width + nx;
-            if (!visited[nidx] &&
-                std::abs(heightmap[nidx] - region_height) < 0.01f) {
-              visited[nidx] = true;
-              stack.push_back(nidx);
+void cleanup_small_regions(std::vector<float> &heightmap, int width, int height,
+                           int terrace_levels, int min_region_size,
+                           bool keep_edge_regions, TaskSystem *tasks,
+                           int max_region_extent) {
+  constexpr int BAND_ROWS = 64;
+  int band_count = (height + BAND_ROWS - 1) / BAND_ROWS;
+  auto for_each_band = [&](const std::function<void(int, int)> &fn) {
+    TaskSystem::run(tasks, band_count, [&](int b) {
+      fn(b * BAND_ROWS, std::min(height, (b + 1) * BAND_ROWS));
+    });
+  };
+
+  std::vector<int32_t> levels((size_t)width * height);
+  for_each_band([&](int y0, int y1) {
+    for (size_t i = (size_t)y0 * width; i < (size_t)y1 * width; ++i)
+      levels[i] = (int32_t)std::lround(heightmap[i] * terrace_levels);
+  });
+  ComponentLabels regions =
+      label_components(levels, width, height, Connectivity::Four, tasks);
+  levels = {};
+
+  std::vector<int32_t> small_of(regions.count(), -1);
+  std::vector<int32_t> small_regions;
+  for (int r = 0; r < regions.count(); ++r) {
+    const ComponentStats &s = regions.components[r];
+    bool narrow = s.max_x - s.min_x < max_region_extent && s.max_y - s.min_y < max_region_extent;
+    if (s.area < min_region_size && narrow &&
+        !(keep_edge_regions && s.touches_border(width, height))) {
+      small_of[r] = (int32_t)small_regions.size();
+      small_regions.push_back(r);
+    }
+  }
+  if (small_regions.empty())
+    return;
+
+  // One sweep sums, for every small region, the 8-neighbours of its pixels
+  // that sit on another level. A region inside a single band is summed by
+  // that band alone; the few that straddle bands are summed per band and
+  // merged in band order, so the result is the same for any thread count.
+  struct Border {
+    double sum = 0.0;
+    int count = 0;
+  };
+  std::vector<Border> border(small_regions.size());
+  std::vector<std::unordered_map<int32_t, Border>> straddling(band_count);
+
+  for_each_band([&](int y0, int y1) {
+    auto &partial = straddling[y0 / BAND_ROWS];
+    for (int y = y0; y < y1; ++y) {
+      for (int x = 0; x < width; ++x) {
+        int32_t r = regions.labels[(size_t)y * width + x];
+        int32_t si = r < 0 ? -1 : small_of[r];
+        if (si < 0)
+          continue;
+        const ComponentStats &s = regions.components[small_regions[si]];
+        float region_height = heightmap[s.first_pixel];
+        bool inside = s.min_y >= y0 && s.max_y < y1;
+        Border &acc = inside ? border[si] : partial[si];
+
+        for (int dy = -1; dy <= 1; ++dy) {
+          int ny = y + dy;
+          if (ny < 0 || ny >= height)
+            continue;
+          for (int dx = -1; dx <= 1; ++dx) {
+            int nx = x + dx;
+            if (nx < 0 || nx >= width)
+              continue;
+            float nh = heightmap[(size_t)ny * width + nx];
+            if (std::abs(nh - region_height) > 0.01f) {
+              acc.sum += nh;
+              ++acc.count;
             }
           }
         }
       }
+    }
+  });
 
-      if ((int)region_pixels.size() < min_region_size) {
-        float sum = 0;
-        int count = 0;
-
-        for (int idx : region_pixels) {
-          int px = idx % width;
-          int py = idx / width;
-
-          for (int dy = -1; dy <= 1; ++dy) {
-            for (int dx = -1; dx <= 1; ++dx) {
-              int nx = px + dx, ny = py + dy;
-              if (nx >= 0 && nx < width && ny >= 0 && ny < height) {
-                int nidx = ny * width + nx;
-                if (std::abs(heightmap[nidx] - region_height) > 0.01f) {
-                  sum += heightmap[nidx];
-                  count++;
-                }
-              }
-            }
-          }
-        }
-
-        float replacement = (count > 0) ? sum / count : region_height;
-        for (int idx : region_pixels) {
-          heightmap[idx] = replacement;
-        }
-      }
+  for (const auto &partial : straddling) {
+    for (const auto &[si, acc] : partial) {
+      border[si].sum += acc.sum;
+      border[si].count += acc.count;
     }
   }
+
+  std::vector<float> replacement(small_regions.size());
+  for (size_t si = 0; si < small_regions.size(); ++si) {
+    float region_height = heightmap[regions.components[small_regions[si]].first_pixel];
+    replacement[si] = border[si].count > 0
+                          ? (float)(border[si].sum / border[si].count)
+                          : region_height;
+  }
+
+  for_each_band([&](int y0, int y1) {
+    for (size_t i = (size_t)y0 * width; i < (size_t)y1 * width; ++i) {
+      int32_t r = regions.labels[i];
+      if (r >= 0 && small_of[r] >= 0)
+        heightmap[i] = replacement[small_of[r]];
+    }
+  });
 }
 
 void compose_layers(MapData &data, const ElevationParams &elev,
                     const RiverParams &river, const WorleyParams &worley,
-                    const CompositionParams &comp, NoiseCache *cache) {
+                    const CompositionParams &comp, NoiseCache *cache,
+                    TaskSystem *tasks, NoiseRanges *ranges) {
   int w = data.width;
   int h = data.height;
   int n = w * h;
@@ -88,17 +123,30 @@ void compose_layers(MapData &data, const ElevationParams &elev,
   SDL_Log("Composing layers (%dx%d)...", w, h);
   auto start = SDL_GetTicks();
 
+  // Cached layers were normalised against their own range.
+  if (ranges)
+    cache = nullptr;
+
+  ElevationParams elev_placed = elev;
+  elev_placed.origin_x = data.origin_x;
+  elev_placed.origin_y = data.origin_y;
   RiverParams river_scaled = river;
   river_scaled.map_scale = elev.map_scale;
+  river_scaled.origin_x = data.origin_x;
+  river_scaled.origin_y = data.origin_y;
   WorleyParams worley_scaled = worley;
   worley_scaled.map_scale = elev.map_scale;
+  worley_scaled.origin_x = data.origin_x;
+  worley_scaled.origin_y = data.origin_y;
 
-  uint64_t elev_hash = cache ? NoiseCache::hash_params(elev) : 0;
-  uint64_t river_hash = cache ? NoiseCache::hash_params(river_scaled) : 0;
-  uint64_t worley_hash = cache ? NoiseCache::hash_params(worley_scaled) : 0;
+  uint64_t elev_hash = cache ? NoiseCache::layer_key(elev_placed, w, h) : 0;
+  uint64_t river_hash = cache ? NoiseCache::layer_key(river_scaled, w, h) : 0;
+  uint64_t worley_hash = cache ? NoiseCache::layer_key(worley_scaled, w, h) : 0;
 
   if (!cache || !cache->get(NoiseCache::ELEVATION, elev_hash, data.elevation)) {
-    generate_elevation_layer(data.elevation, w, h, elev);
+    std::vector<float> layer;
+    generate_elevation_layer(layer, w, h, elev_placed, tasks);
+    data.elevation = std::make_shared<const std::vector<float>>(std::move(layer));
     if (cache)
       cache->put(NoiseCache::ELEVATION, elev_hash, data.elevation);
     SDL_Log("  Elevation: generated");
@@ -107,7 +155,10 @@ void compose_layers(MapData &data, const ElevationParams &elev,
   }
 
   if (!cache || !cache->get(NoiseCache::RIVER, river_hash, data.river_mask)) {
-    generate_river_mask(data.river_mask, w, h, river_scaled);
+    std::vector<float> layer;
+    generate_river_mask(layer, w, h, river_scaled,
+                        ranges ? &ranges->river : nullptr);
+    data.river_mask = std::make_shared<const std::vector<float>>(std::move(layer));
     if (cache)
       cache->put(NoiseCache::RIVER, river_hash, data.river_mask);
     SDL_Log("  River mask: generated");
@@ -116,25 +167,37 @@ void compose_layers(MapData &data, const ElevationParams &elev,
   }
 
   if (!cache || !cache->get3(NoiseCache::WORLEY, worley_hash, data.worley,
-                             data.worley_edge, data.worley_cell_value)) {
-    generate_worley_layer(data.worley, data.worley_edge, data.worley_cell_value, w, h, worley_scaled);
+                             data.worley_edge, data.worley_cell_value,
+                             &data.worley_cell_id)) {
+    std::vector<float> value, edge, cell_value;
+    std::vector<int32_t> cell_id;
+    generate_worley_layer(value, edge, cell_value, w, h, worley_scaled, &cell_id, ranges);
+    data.worley = std::make_shared<const std::vector<float>>(std::move(value));
+    data.worley_edge = std::make_shared<const std::vector<float>>(std::move(edge));
+    data.worley_cell_value = std::make_shared<const std::vector<float>>(std::move(cell_value));
+    data.worley_cell_id = std::make_shared<const std::vector<int32_t>>(std::move(cell_id));
     if (cache)
       cache->put3(NoiseCache::WORLEY, worley_hash, data.worley,
-                  data.worley_edge, data.worley_cell_value);
+                  data.worley_edge, data.worley_cell_value, data.worley_cell_id);
     SDL_Log("  Worley: generated");
   } else {
     SDL_Log("  Worley: cache hit");
   }
 
   data.final_elevation = data.elevation;
+  const std::vector<float> &final_elevation = *data.final_elevation;
 
+  std::vector<float> basalt_height(n);
   for (int i = 0; i < n; ++i) {
-    data.basalt_height[i] =
-        std::floor(data.final_elevation[i] * comp.terrace_levels) /
+    basalt_height[i] =
+        std::floor(final_elevation[i] * comp.terrace_levels) /
         comp.terrace_levels;
   }
 
-  cleanup_small_regions(data.basalt_height, w, h, comp.min_region_size);
+  cleanup_small_regions(basalt_height, w, h, comp.terrace_levels,
+                        comp.min_region_size, comp.keep_edge_regions, tasks,
+                        comp.max_region_extent);
+  data.basalt_height = std::make_shared<const std::vector<float>>(std::move(basalt_height));
 
   SDL_Log("Layer composition: %llu ms", SDL_GetTicks() - start);
 }
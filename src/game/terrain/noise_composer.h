@@ -2,6 +2,7 @@
 #include "terrain/map_data.h"
 #include "terrain/noise_cache.h"
 #include "terrain/noise_layers.h"
+#include <climits>
 
 struct CompositionParams {
   float river_elevation_max = 0.35f;
@@ -9,8 +10,22 @@ struct CompositionParams {
   int terrace_levels = 8;
 
   int min_region_size = 10000;
+  // Keep regions that touch the raster edge; their true size lies outside.
+  bool keep_edge_regions = false;
+  // Keep regions wider or taller than this many pixels, whatever their area.
+  int max_region_extent = INT_MAX;
 };
 
+// Replaces every terrace region (4-connected pixels on one level) smaller
+// than min_region_size, and no wider or taller than max_region_extent, with
+// the mean height of the pixels bordering it. All regions see the original
+// heights, so they are replaced in parallel.
+void cleanup_small_regions(std::vector<float> &heightmap, int width, int height,
+                           int terrace_levels, int min_region_size,
+                           bool keep_edge_regions, TaskSystem *tasks = nullptr,
+                           int max_region_extent = INT_MAX);
+
 void compose_layers(MapData &data, const ElevationParams &elev,
                     const RiverParams &river, const WorleyParams &worley,
-                    const CompositionParams &comp, NoiseCache *cache = nullptr);
+                    const CompositionParams &comp, NoiseCache *cache = nullptr,
+                    TaskSystem *tasks = nullptr, NoiseRanges *ranges = nullptr);
@@ -1,5 +1,7 @@
 #include "terrain/noise_layers.h"
 #include "terrain/FastNoiseLite.h"
+#include "terrain/noise_simd.h"
+#include "core/task_system.h"
 #include <algorithm>
 #include <cmath>
 #include <vector>
@@ -22,67 +24,92 @@ static float biased_smoothstep(float t, float bias) {
   return smooth * (1.0f - bias) + ease_out * bias;
 }
 
-void generate_elevation_layer(std::vector<float> &out, int width, int height,
-                              const ElevationParams &params) {
-  int n = width * height;
-  out.resize(n);
-
-  std::vector<float> gradient_x(n, 0.0f);
-  std::vector<float> gradient_y(n, 0.0f);
-  std::fill(out.begin(), out.end(), 0.0f);
-
-  FastNoiseLite noise(params.seed);
-  noise.SetNoiseType(FastNoiseLite::NoiseType_OpenSimplex2);
-  noise.SetFractalType(FastNoiseLite::FractalType_None);
+// Accumulates the eroded octave sum for interior rows [y0, y1). Each pixel only
+// reads its own gradient state plus the raw octave noise of its 4-neighbours,
+// so a band needs a one-row halo of noise above and below and nothing else;
+// splitting the grid into bands gives the same result as one full-height band.
+static void elevation_band(std::vector<float> &out, int width, int height,
+                           int y0, int y1, const ElevationParams &params,
+                           float ox, float oy) {
+  y0 = std::max(y0, 1);
+  y1 = std::min(y1, height - 1);
+  if (y0 >= y1 || width < 3)
+    return;
+
+  const int rows = y1 - y0;
+  const int halo_y0 = y0 - 1;
+  const int halo_rows = rows + 2;
+
+  std::vector<float> gradient_x((size_t)rows * width, 0.0f);
+  std::vector<float> gradient_y((size_t)rows * width, 0.0f);
+  std::vector<float> octave_values((size_t)halo_rows * width);
 
   float amplitude = 1.0f;
   float frequency = params.frequency;
-  float max_value = 0.0f;
+  const float x0 = (float)params.origin_x * params.map_scale + ox;
 
   constexpr float GRADIENT_SCALE = 2.0f;
 
-  float ox, oy;
-  seed_offset(params.seed, ox, oy);
-
   for (int octave = 0; octave < params.octaves; ++octave) {
-    noise.SetFrequency(frequency);
-
-    std::vector<float> octave_values(n);
-    for (int y = 0; y < height; ++y) {
-      for (int x = 0; x < width; ++x) {
-        float world_x = (float)x * params.map_scale + ox;
-        float world_y = (float)y * params.map_scale + oy;
-        octave_values[y * width + x] = noise.GetNoise(world_x, world_y);
-      }
+    for (int hy = 0; hy < halo_rows; ++hy) {
+      float world_y = (float)(params.origin_y + halo_y0 + hy) * params.map_scale + oy;
+      simplex2_row(params.seed, frequency, x0, params.map_scale, world_y, width,
+                   &octave_values[(size_t)hy * width]);
     }
 
-    for (int y = 1; y < height - 1; ++y) {
+    for (int y = y0; y < y1; ++y) {
+      const float *row = &octave_values[(size_t)(y - halo_y0) * width];
+      const float *row_up = row - width;
+      const float *row_down = row + width;
+      float *gx_row = &gradient_x[(size_t)(y - y0) * width];
+      float *gy_row = &gradient_y[(size_t)(y - y0) * width];
+      float *out_row = &out[(size_t)y * width];
+
       for (int x = 1; x < width - 1; ++x) {
-        int idx = y * width + x;
-        float grad_magnitude = std::sqrt(gradient_x[idx] * gradient_x[idx] +
-                                         gradient_y[idx] * gradient_y[idx]);
+        float grad_magnitude = std::sqrt(gx_row[x] * gx_row[x] +
+                                         gy_row[x] * gy_row[x]);
 
         float erosion_factor = 1.0f / (1.0f + grad_magnitude * GRADIENT_SCALE);
         float scaled_amplitude = amplitude * erosion_factor;
 
-        out[idx] += octave_values[idx] * scaled_amplitude;
+        out_row[x] += row[x] * scaled_amplitude;
 
-        float dx = (octave_values[y * width + (x + 1)] -
-                    octave_values[y * width + (x - 1)]) *
-                   0.5f;
-        float dy = (octave_values[(y + 1) * width + x] -
-                    octave_values[(y - 1) * width + x]) *
-                   0.5f;
+        float dx = (row[x + 1] - row[x - 1]) * 0.5f;
+        float dy = (row_down[x] - row_up[x]) * 0.5f;
 
-        gradient_x[idx] += dx * scaled_amplitude * frequency;
-        gradient_y[idx] += dy * scaled_amplitude * frequency;
+        gx_row[x] += dx * scaled_amplitude * frequency;
+        gy_row[x] += dy * scaled_amplitude * frequency;
       }
     }
 
-    max_value += amplitude;
     amplitude *= params.gain;
     frequency *= params.lacunarity;
   }
+}
+
+void generate_elevation_layer(std::vector<float> &out, int width, int height,
+                              const ElevationParams &params, TaskSystem *tasks) {
+  int n = width * height;
+  out.resize(n);
+  std::fill(out.begin(), out.end(), 0.0f);
+
+  float ox, oy;
+  seed_offset(params.seed, ox, oy);
+
+  constexpr int BAND_ROWS = 32;
+  int band_count = (height + BAND_ROWS - 1) / BAND_ROWS;
+
+  TaskSystem::run(tasks, band_count, [&](int b) {
+    elevation_band(out, width, height, b * BAND_ROWS, (b + 1) * BAND_ROWS,
+                   params, ox, oy);
+  });
+
+  float max_value = 0.0f;
+  float amplitude = 1.0f;
+  for (int octave = 0; octave < params.octaves; ++octave) {
+    max_value += amplitude;
+    amplitude *= params.gain;
+  }
 
   for (int x = 0; x < width; ++x) {
     out[x] = out[width + x];
@@ -102,49 +129,48 @@ void generate_elevation_layer(std::vector<float> &out, int width, int height,
   }
 }
 
+static float normalize_in_range(float v, const LayerRange &range) {
+  return std::clamp((v - range.min) / (range.max - range.min), 0.0f, 1.0f);
+}
+
 void generate_river_mask(std::vector<float> &out, int width, int height,
-                         const RiverParams &params) {
+                         const RiverParams &params, LayerRange *range) {
   int n = width * height;
   out.resize(n);
 
-  FastNoiseLite noise(params.seed);
-  noise.SetNoiseType(FastNoiseLite::NoiseType_OpenSimplex2);
-  noise.SetFractalType(FastNoiseLite::FractalType_Ridged);
-  noise.SetFrequency(params.frequency);
-  noise.SetFractalOctaves(params.octaves);
-  noise.SetFractalLacunarity(params.lacunarity);
-  noise.SetFractalGain(params.gain);
-
   float ox, oy;
   seed_offset(params.seed, ox, oy);
+  const float x0 = (float)params.origin_x * params.map_scale + ox;
 
   float min_val = 1e9f, max_val = -1e9f;
   for (int y = 0; y < height; ++y) {
+    float *row = &out[(size_t)y * width];
+    simplex2_ridged_row(params.seed, params.frequency, params.octaves,
+                        params.lacunarity, params.gain, x0, params.map_scale,
+                        (float)(params.origin_y + y) * params.map_scale + oy, width, row);
     for (int x = 0; x < width; ++x) {
-      float v = noise.GetNoise((float)x * params.map_scale + ox, (float)y * params.map_scale + oy);
-      out[y * width + x] = v;
-      min_val = std::min(min_val, v);
-      max_val = std::max(max_val, v);
+      min_val = std::min(min_val, row[x]);
+      max_val = std::max(max_val, row[x]);
     }
   }
 
-  float range = max_val - min_val;
-  if (range > 1e-6f) {
+  if (range && !range->empty()) {
+    for (int i = 0; i < n; ++i)
+      out[i] = normalize_in_range(out[i], *range);
+    return;
+  }
+  if (range)
+    *range = {min_val, max_val};
+
+  float span = max_val - min_val;
+  if (span > 1e-6f) {
     for (int i = 0; i < n; ++i) {
-      out[i] = (out[i] - min_val) / range;
+      out[i] = (out[i] - min_val) / span;
     }
   }
 }
 
-void generate_worley_layer(std::vector<float> &out_value,
-                           std::vector<float> &out_edge,
-                           std::vector<float> &out_cell_value, int width, int height,
-                           const WorleyParams &params) {
-  int n = width * height;
-  out_value.resize(n);
-  out_edge.resize(n);
-  out_cell_value.resize(n);
-
+static FastNoiseLite make_worley_warp(const WorleyParams &params) {
   FastNoiseLite warp(params.seed + 31337);
   warp.SetDomainWarpType(FastNoiseLite::DomainWarpType_OpenSimplex2);
   warp.SetDomainWarpAmp(params.warp_amp);
@@ -153,35 +179,88 @@ void generate_worley_layer(std::vector<float> &out_value,
   warp.SetFractalOctaves(params.warp_octaves);
   warp.SetFractalLacunarity(2.0f);
   warp.SetFractalGain(0.5f);
+  return warp;
+}
+
+static int floor_div(int a, int b) {
+  return a / b - ((a % b != 0) && ((a < 0) != (b < 0)));
+}
+
+// Warp offsets sampled every `step` world pixels, with one extra lattice row
+// and column past the map edge so every pixel has four surrounding samples.
+// Nodes sit on world multiples of `step` so neighbouring chunks share them.
+struct WarpLattice {
+  int step = 1;
+  int lw = 0, lh = 0;
+  int skew_x = 0, skew_y = 0;
+  std::vector<float> dx, dy;
+
+  void build(const FastNoiseLite &warp, const WorleyParams &params, int width,
+             int height, int lattice_step, float ox, float oy) {
+    step = lattice_step;
+    const int base_x = floor_div(params.origin_x, step) * step;
+    const int base_y = floor_div(params.origin_y, step) * step;
+    skew_x = params.origin_x - base_x;
+    skew_y = params.origin_y - base_y;
+    lw = (skew_x + width - 1) / step + 2;
+    lh = (skew_y + height - 1) / step + 2;
+    dx.resize((size_t)lw * lh);
+    dy.resize((size_t)lw * lh);
+    for (int ly = 0; ly < lh; ++ly) {
+      for (int lx = 0; lx < lw; ++lx) {
+        float bx = (float)(base_x + lx * step) * params.map_scale + ox;
+        float by = (float)(base_y + ly * step) * params.map_scale + oy;
+        float wx = bx, wy = by;
+        warp.DomainWarp(wx, wy);
+        dx[ly * lw + lx] = wx - bx;
+        dy[ly * lw + lx] = wy - by;
+      }
+    }
+  }
+
+  void sample(int x, int y, float &out_dx, float &out_dy) const {
+    x += skew_x;
+    y += skew_y;
+    int lx = x / step, ly = y / step;
+    float tx = (float)(x - lx * step) / step;
+    float ty = (float)(y - ly * step) / step;
+    int i00 = ly * lw + lx;
+    int i10 = i00 + 1;
+    int i01 = i00 + lw;
+    int i11 = i01 + 1;
+    float top_x = dx[i00] + (dx[i10] - dx[i00]) * tx;
+    float bot_x = dx[i01] + (dx[i11] - dx[i01]) * tx;
+    float top_y = dy[i00] + (dy[i10] - dy[i00]) * tx;
+    float bot_y = dy[i01] + (dy[i11] - dy[i01]) * tx;
+    out_dx = top_x + (bot_x - top_x) * ty;
+    out_dy = top_y + (bot_y - top_y) * ty;
+  }
+};
+
+void generate_worley_layer(std::vector<float> &out_value,
+                           std::vector<float> &out_edge,
+                           std::vector<float> &out_cell_value, int width, int height,
+                           const WorleyParams &params,
+                           std::vector<int32_t> *out_cell_id,
+                           NoiseRanges *ranges) {
+  int n = width * height;
+  out_value.resize(n);
+  out_edge.resize(n);
+  out_cell_value.resize(n);
+  if (out_cell_id)
+    out_cell_id->resize(n);
 
-  FastNoiseLite noise_dist(params.seed);
-  noise_dist.SetNoiseType(FastNoiseLite::NoiseType_Cellular);
-  noise_dist.SetCellularDistanceFunction(
-      FastNoiseLite::CellularDistanceFunction_EuclideanSq);
-  noise_dist.SetCellularReturnType(FastNoiseLite::CellularReturnType_Distance);
-  noise_dist.SetFrequency(params.frequency);
-  noise_dist.SetCellularJitter(params.jitter);
-
-  FastNoiseLite noise_cell(params.seed);
-  noise_cell.SetNoiseType(FastNoiseLite::NoiseType_Cellular);
-  noise_cell.SetCellularDistanceFunction(
-      FastNoiseLite::CellularDistanceFunction_EuclideanSq);
-  noise_cell.SetCellularReturnType(FastNoiseLite::CellularReturnType_CellValue);
-  noise_cell.SetFrequency(params.frequency);
-  noise_cell.SetCellularJitter(params.jitter);
-
-  FastNoiseLite noise_edge(params.seed);
-  noise_edge.SetNoiseType(FastNoiseLite::NoiseType_Cellular);
-  noise_edge.SetCellularDistanceFunction(
-      FastNoiseLite::CellularDistanceFunction_EuclideanSq);
-  noise_edge.SetCellularReturnType(
-      FastNoiseLite::CellularReturnType_Distance2Sub);
-  noise_edge.SetFrequency(params.frequency);
-  noise_edge.SetCellularJitter(params.jitter);
+  FastNoiseLite warp = make_worley_warp(params);
 
   float ox, oy;
   seed_offset(params.seed, ox, oy);
 
+  const bool warped = params.warp_amp > 0.0f;
+  const bool coarse_warp = warped && params.warp_lattice_step > 1;
+  WarpLattice lattice;
+  if (coarse_warp)
+    lattice.build(warp, params, width, height, params.warp_lattice_step, ox, oy);
+
   float min_d = 1e9f, max_d = -1e9f;
   float min_e = 1e9f, max_e = -1e9f;
   float min_c = 1e9f, max_c = -1e9f;
@@ -189,16 +268,26 @@ void generate_worley_layer(std::vector<float> &out_value,
   for (int y = 0; y < height; ++y) {
     for (int x = 0; x < width; ++x) {
       int idx = y * width + x;
-      float wx = (float)x * params.map_scale + ox;
-      float wy = (float)y * params.map_scale + oy;
-      if (params.warp_amp > 0.0f)
+      float wx = (float)(params.origin_x + x) * params.map_scale + ox;
+      float wy = (float)(params.origin_y + y) * params.map_scale + oy;
+      if (coarse_warp) {
+        float dx, dy;
+        lattice.sample(x, y, dx, dy);
+        wx += dx;
+        wy += dy;
+      } else if (warped) {
         warp.DomainWarp(wx, wy);
-      float d = noise_dist.GetNoise(wx, wy);
-      float e = noise_edge.GetNoise(wx, wy);
-      float c = noise_cell.GetNoise(wx, wy);
+      }
+      CellularSample cs =
+          cellular_sample(params.seed, params.frequency, params.jitter, wx, wy);
+      float d = cs.distance;
+      float e = cs.distance2_sub;
+      float c = cs.cell_value;
       out_value[idx] = d;
       out_edge[idx] = e;
       out_cell_value[idx] = c;
+      if (out_cell_id)
+        (*out_cell_id)[idx] = cs.cell_id;
       min_d = std::min(min_d, d);
       max_d = std::max(max_d, d);
       min_e = std::min(min_e, e);
@@ -208,6 +297,20 @@ void generate_worley_layer(std::vector<float> &out_value,
     }
   }
 
+  if (ranges && !ranges->worley_distance.empty()) {
+    for (int i = 0; i < n; ++i) {
+      out_value[i] = normalize_in_range(out_value[i], ranges->worley_distance);
+      out_edge[i] = normalize_in_range(out_edge[i], ranges->worley_edge);
+      out_cell_value[i] = normalize_in_range(out_cell_value[i], ranges->worley_cell);
+    }
+    return;
+  }
+  if (ranges) {
+    ranges->worley_distance = {min_d, max_d};
+    ranges->worley_edge = {min_e, max_e};
+    ranges->worley_cell = {min_c, max_c};
+  }
+
   float range_d = max_d - min_d;
   float range_e = max_e - min_e;
   float range_c = max_c - min_c;
@@ -220,3 +323,33 @@ void generate_worley_layer(std::vector<float> &out_value,
         (range_c > 1e-6f) ? (out_cell_value[i] - min_c) / range_c : 0.0f;
   }
 }
+
+float measure_worley_warp_error(int width, int height, const WorleyParams &params) {
+  if (params.warp_amp <= 0.0f || params.warp_lattice_step <= 1 ||
+      width <= 0 || height <= 0)
+    return 0.0f;
+
+  FastNoiseLite warp = make_worley_warp(params);
+
+  float ox, oy;
+  seed_offset(params.seed, ox, oy);
+
+  WarpLattice lattice;
+  lattice.build(warp, params, width, height, params.warp_lattice_step, ox, oy);
+
+  float max_err2 = 0.0f;
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      float bx = (float)(params.origin_x + x) * params.map_scale + ox;
+      float by = (float)(params.origin_y + y) * params.map_scale + oy;
+      float wx = bx, wy = by;
+      warp.DomainWarp(wx, wy);
+      float dx, dy;
+      lattice.sample(x, y, dx, dy);
+      float ex = (bx + dx) - wx;
+      float ey = (by + dy) - wy;
+      max_err2 = std::max(max_err2, ex * ex + ey * ey);
+    }
+  }
+  return std::sqrt(max_err2) / params.map_scale;
+}
@@ -1,6 +1,9 @@
 #pragma once
+#include <cstdint>
 #include <vector>
 
+class TaskSystem;
+
 struct ElevationParams {
   float frequency = 0.003f;
   int octaves = 6;
@@ -9,6 +12,9 @@ struct ElevationParams {
   int seed = 0;
   float scurve_bias = 0.65f;
   float map_scale = 1.0f;
+  // World pixel of the raster's (0, 0); non-zero for world chunks.
+  int origin_x = 0;
+  int origin_y = 0;
 };
 
 struct RiverParams {
@@ -19,6 +25,8 @@ struct RiverParams {
   int seed = 0;
   float threshold = 0.7f;
   float map_scale = 1.0f;
+  int origin_x = 0;
+  int origin_y = 0;
 };
 
 struct WorleyParams {
@@ -26,18 +34,47 @@ struct WorleyParams {
   int seed = 0;
   float jitter = 1.0f;
   float map_scale = 1.0f;
+  int origin_x = 0;
+  int origin_y = 0;
   float warp_amp = 40.0f;
   float warp_frequency = 0.003f;
   int warp_octaves = 3;
+  // Evaluate the warp every Nth pixel and bilinearly interpolate between;
+  // 1 warps every pixel exactly.
+  int warp_lattice_step = 1;
+};
+
+struct LayerRange {
+  float min = 0.0f;
+  float max = 0.0f;
+  bool empty() const { return !(max > min); }
+};
+
+// Normalisation ranges for the layers that rescale by their own min/max.
+// Rasters that must agree at shared borders (world chunks) pass one set of
+// ranges; empty ranges are measured from the raster and filled in.
+struct NoiseRanges {
+  LayerRange river;
+  LayerRange worley_distance;
+  LayerRange worley_edge;
+  LayerRange worley_cell;
 };
 
 void generate_elevation_layer(std::vector<float> &out, int width, int height,
-                              const ElevationParams &params);
+                              const ElevationParams &params,
+                              TaskSystem *tasks = nullptr);
 
 void generate_river_mask(std::vector<float> &out, int width, int height,
-                         const RiverParams &params);
+                         const RiverParams &params,
+                         LayerRange *range = nullptr);
 
 void generate_worley_layer(std::vector<float> &out_value,
                            std::vector<float> &out_edge,
                            std::vector<float> &out_cell_value, int width, int height,
-                           const WorleyParams &params);
+                           const WorleyParams &params,
+                           std::vector<int32_t> *out_cell_id = nullptr,
+                           NoiseRanges *ranges = nullptr);
+
+// Largest distance, in pixels, between the warped sample positions produced
+// with params.warp_lattice_step and with a full-rate warp.
+float measure_worley_warp_error(int width, int height, const WorleyParams &params);
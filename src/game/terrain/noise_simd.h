@@ -0,0 +1,29 @@
+#pragma once
+#include <cstdint>
+
+// Row-batched 2D OpenSimplex2 matching FastNoiseLite's NoiseType_OpenSimplex2.
+// Sample i of a row sits at ((float)i * step_x + x0, y) before frequency
+// scaling, which is how the noise layers address their pixels. Rows are
+// evaluated 8 lanes at a time with AVX2 gathers, 4 lanes on SSE/NEON, and a
+// scalar loop for the tail and on other targets.
+
+// FractalType_None.
+void simplex2_row(int seed, float frequency, float x0, float step_x, float y,
+                  int count, float *out);
+
+// FractalType_Ridged with the default weighted strength of 0.
+void simplex2_ridged_row(int seed, float frequency, int octaves,
+                         float lacunarity, float gain, float x0, float step_x,
+                         float y, int count, float *out);
+
+// FastNoiseLite cellular noise (EuclideanSq distance, no fractal) with every
+// return type the Worley layer uses taken from one 3x3 neighbourhood scan.
+struct CellularSample {
+  float distance;      // CellularReturnType_Distance
+  float distance2_sub; // CellularReturnType_Distance2Sub
+  float cell_value;    // CellularReturnType_CellValue
+  int32_t cell_id;     // hash of the nearest feature point's lattice cell
+};
+
+CellularSample cellular_sample(int seed, float frequency, float jitter,
+                               float x, float y);
@@ -1,33 +1,41 @@
 #include "terrain/terrain_lighting.h"
 #include "terrain/hex.h"
 #include "terrain/map_data.h"
+#include "core/task_system.h"
 #include <algorithm>
+#include <array>
 #include <cmath>
+#include <functional>
+#include <initializer_list>
+
+static constexpr int SWEEP_LINES_PER_TASK = 64;
+static constexpr int BAKE_BAND_ROWS = 64;
+// Range sigma of the upsampling filter, as a fraction of height_scale; well
+// below one terrace step so samples from a neighbouring hex top barely count.
+static constexpr float UPSAMPLE_SIGMA = 0.005f;
+
+// Runs fn(i0, i1) over [0, n) in row bands of the bake.
+static void for_each_band(size_t n, int width, TaskSystem *tasks,
+                          const std::function<void(size_t, size_t)> &fn) {
+  size_t band = (size_t)BAKE_BAND_ROWS * std::max(width, 1);
+  int band_count = (int)((n + band - 1) / band);
+  TaskSystem::run(tasks, band_count, [&](int b) {
+    fn((size_t)b * band, std::min(n, (size_t)(b + 1) * band));
+  });
+}
 
 static std::vector<float> rasterize_heights(const MapData &map, float hex_size,
                                             float height_scale) {
   const int w = map.width, h = map.height;
-  std::vector<float> H(map.basalt_height.begin(), map.basalt_height.end());
-
-  for (const auto &col : map.columns) {
-    Vec2 corners[6];
-    get_hex_corners(col.q, col.r, hex_size, corners);
-    float fmin_x = 1e9f, fmax_x = -1e9f, fmin_y = 1e9f, fmax_y = -1e9f;
-    for (int i = 0; i < 6; ++i) {
-      fmin_x = std::min(fmin_x, corners[i].x);
-      fmax_x = std::max(fmax_x, corners[i].x);
-      fmin_y = std::min(fmin_y, corners[i].y);
-      fmax_y = std::max(fmax_y, corners[i].y);
-    }
-    int x0 = std::max(0, (int)fmin_x - 1);
-    int x1 = std::min(w - 1, (int)fmax_x + 1);
-    int y0 = std::max(0, (int)fmin_y - 1);
-    int y1 = std::min(h - 1, (int)fmax_y + 1);
-    for (int ry = y0; ry <= y1; ++ry) {
-      for (int rx = x0; rx <= x1; ++rx) {
-        if (pixel_in_hex((float)rx, (float)ry, col.q, col.r, hex_size))
-          H[ry * w + rx] = col.height;
-      }
+  std::vector<float> H(*map.basalt_height);
+
+  std::vector<HexSpan> spans;
+  const HexColumnsSoA &cols = map.columns;
+  for (size_t c = 0; c < cols.size(); ++c) {
+    rasterize_hex(cols.q[c], cols.r[c], hex_size, 0.0f, 0.0f, w, h, spans);
+    for (const HexSpan &sp : spans) {
+      float *row = H.data() + (size_t)sp.y * w;
+      std::fill(row + sp.x0, row + sp.x1 + 1, cols.height[c]);
     }
   }
 
@@ -38,103 +46,305 @@ static std::vector<float> rasterize_heights(const MapData &map, float hex_size,
 
 void sweep_horizon(const std::vector<float> &heights, int width, int height,
                    int step_dx, int step_dy, float step_world_units,
-                   std::vector<float> &out_angles) {
+                   std::vector<float> &out_angles, TaskSystem *tasks,
+                   const std::vector<HorizonOccluder> *occluders) {
   out_angles.assign((size_t)width * height, TERRAIN_HORIZON_NONE);
+  const HorizonOccluder *occ = occluders ? occluders->data() : nullptr;
 
-  std::vector<float> hull_t, hull_h;
-
-  auto run_line = [&](int sx, int sy) {
-    hull_t.clear();
-    hull_h.clear();
-    float t = 0.0f;
-    for (int x = sx, y = sy; x >= 0 && x < width && y >= 0 && y < height;
-         x += step_dx, y += step_dy, t += step_world_units) {
-      float hz = heights[y * width + x];
-
-      while (hull_t.size() >= 2) {
-        size_t n = hull_t.size();
-        float cross =
-            (hull_t[n - 1] - hull_t[n - 2]) * (hz - hull_h[n - 2]) -
-            (hull_h[n - 1] - hull_h[n - 2]) * (t - hull_t[n - 2]);
-        if (cross < 0.0f)
-          break;
-        hull_t.pop_back();
-        hull_h.pop_back();
-      }
-
-      if (!hull_t.empty())
-        out_angles[y * width + x] =
-            std::atan2(hull_h.back() - hz, t - hull_t.back());
-
-      hull_t.push_back(t);
-      hull_h.push_back(hz);
-    }
-  };
-
+  // Every line starts at a pixel whose predecessor is off the map.
+  std::vector<std::pair<int, int>> starts;
   for (int y = 0; y < height; ++y) {
     for (int x = 0; x < width; ++x) {
       int px = x - step_dx, py = y - step_dy;
       if (px < 0 || px >= width || py < 0 || py >= height)
-        run_line(x, y);
+        starts.push_back({x, y});
     }
   }
+
+  // Lines cover disjoint pixels, so groups of them run as independent
+  // tasks, each with its own hull scratch.
+  int task_count = (int)((starts.size() + SWEEP_LINES_PER_TASK - 1) / SWEEP_LINES_PER_TASK);
+  TaskSystem::run(tasks, task_count, [&](int task) {
+    std::vector<float> hull_t, hull_h;
+    size_t end = std::min(starts.size(), (size_t)(task + 1) * SWEEP_LINES_PER_TASK);
+    for (size_t i = (size_t)task * SWEEP_LINES_PER_TASK; i < end; ++i) {
+      hull_t.clear();
+      hull_h.clear();
+      float t = 0.0f;
+      for (int x = starts[i].first, y = starts[i].second;
+           x >= 0 && x < width && y >= 0 && y < height;
+           x += step_dx, y += step_dy, t += step_world_units) {
+        const size_t p = (size_t)y * width + x;
+        float hz = heights[p];
+        float oh = occ ? occ[p].height : hz;
+        float ot = occ ? t + occ[p].offset : t;
+
+        // A sample is measured from where its occluder stands and is no
+        // higher than it, so its tangent is the point the occluder pops
+        // back to or one of the points it pops.
+        float best_t = 0.0f, best_h = 0.0f;
+        bool found = false;
+        auto consider = [&](float pt, float ph) {
+          if (!found || (ph - hz) * (ot - best_t) > (best_h - hz) * (ot - pt)) {
+            best_t = pt;
+            best_h = ph;
+            found = true;
+          }
+        };
+        while (hull_t.size() >= 2) {
+          size_t n = hull_t.size();
+          float cross =
+              (hull_t[n - 1] - hull_t[n - 2]) * (oh - hull_h[n - 2]) -
+              (hull_h[n - 1] - hull_h[n - 2]) * (ot - hull_t[n - 2]);
+          if (cross < 0.0f)
+            break;
+          if (occ)
+            consider(hull_t.back(), hull_h.back());
+          hull_t.pop_back();
+          hull_h.pop_back();
+        }
+
+        if (!hull_t.empty()) {
+          consider(hull_t.back(), hull_h.back());
+          out_angles[p] = std::atan2(best_h - hz, ot - best_t);
+        }
+
+        hull_t.push_back(ot);
+        hull_h.push_back(oh);
+      }
+    }
+  });
 }
 
-TerrainLightBake bake_terrain_lighting(const MapData &map,
-                                       const TerrainLightParams &params) {
-  TerrainLightBake bake;
-  bake.width = map.width;
-  bake.height = map.height;
+// Full-resolution pixel that coarse sample (lx, ly) is taken from: the
+// centre of its div x div block, clamped to the map.
+static size_t coarse_sample_pixel(int lx, int ly, int div, int w, int h) {
+  return (size_t)std::min(h - 1, ly * div + div / 2) * w + std::min(w - 1, lx * div + div / 2);
+}
+
+// Joint bilateral upsampling of coarse grids sampled at coarse_sample_pixel,
+// in place. Each pixel blends the four surrounding samples bilinearly,
+// weighted down by how far their guide height is from the pixel's, so values
+// do not bleed across hex edges. When every sample is on another height the
+// closest one is used.
+static void upsample_guided(std::initializer_list<std::vector<float> *> channels,
+                            const std::vector<float> &coarse_guide, int lw, int lh, int div,
+                            const std::vector<float> &guide, int w, int h, float sigma,
+                            TaskSystem *tasks) {
+  // Per column: the two coarse columns around it and the weight of the first.
+  std::vector<int> col0(w), col1(w);
+  std::vector<float> col_w(w);
+  auto taps = [div](int x, int count, int &i0, int &i1, float &w0) {
+    float u = (float)(x - div / 2) / div;
+    float u0 = std::floor(u);
+    i0 = std::clamp((int)u0, 0, count - 1);
+    i1 = std::clamp((int)u0 + 1, 0, count - 1);
+    w0 = 1.0f - (u - u0);
+  };
+  for (int x = 0; x < w; ++x)
+    taps(x, lw, col0[x], col1[x], col_w[x]);
+
+  std::vector<std::vector<float>> full(channels.size());
+  for (auto &f : full)
+    f.resize((size_t)w * h);
+  const float inv_2sigma2 = 1.0f / (2.0f * sigma * sigma);
+  int band_count = (h + BAKE_BAND_ROWS - 1) / BAKE_BAND_ROWS;
+  TaskSystem::run(tasks, band_count, [&](int b) {
+    int y1 = std::min(h, (b + 1) * BAKE_BAND_ROWS);
+    for (int y = b * BAKE_BAND_ROWS; y < y1; ++y) {
+      int r0, r1;
+      float wy0;
+      taps(y, lh, r0, r1, wy0);
+      for (int x = 0; x < w; ++x) {
+        size_t i = (size_t)y * w + x;
+        size_t c[4] = {(size_t)r0 * lw + col0[x], (size_t)r0 * lw + col1[x],
+                       (size_t)r1 * lw + col0[x], (size_t)r1 * lw + col1[x]};
+        float ws[4] = {wy0 * col_w[x], wy0 * (1.0f - col_w[x]),
+                       (1.0f - wy0) * col_w[x], (1.0f - wy0) * (1.0f - col_w[x])};
+        float g = guide[i];
+        float weight = 0.0f, closest_dh = INFINITY;
+        int closest = 0;
+        for (int k = 0; k < 4; ++k) {
+          float dh = coarse_guide[c[k]] - g;
+          float t = dh * dh * inv_2sigma2;
+          // Hex tops are flat, so most samples match the pixel exactly.
+          ws[k] *= t == 0.0f ? 1.0f : (t > 20.0f ? 0.0f : std::exp(-t));
+          weight += ws[k];
+          if (std::abs(dh) < closest_dh) {
+            closest_dh = std::abs(dh);
+            closest = k;
+          }
+        }
+        size_t ch = 0;
+        for (const std::vector<float> *src : channels) {
+          float v;
+          if (weight > 1e-6f) {
+            v = 0.0f;
+            for (int k = 0; k < 4; ++k)
+              v += ws[k] * (*src)[c[k]];
+            v /= weight;
+          } else {
+            v = (*src)[c[closest]];
+          }
+          full[ch++][i] = v;
+        }
+      }
+    }
+  });
+  size_t ch = 0;
+  for (std::vector<float> *dst : channels)
+    dst->swap(full[ch++]);
+}
+
+TerrainHorizons sweep_terrain_horizons(const MapData &map,
+                                       const TerrainLightParams &params,
+                                       TaskSystem *tasks) {
+  TerrainHorizons hz;
+  hz.width = map.width;
+  hz.height = map.height;
   const int w = map.width, h = map.height;
   const size_t n = (size_t)w * h;
-  bake.rgba.assign(n * 4, 255);
   if (n == 0)
-    return bake;
+    return hz;
 
   const float hex_size = params.pixels_per_unit;
   std::vector<float> H = rasterize_heights(map, hex_size, params.height_scale);
 
-  const float axis_step = 1.0f / params.pixels_per_unit;
-  const float diag_step = std::sqrt(2.0f) / params.pixels_per_unit;
-  const float deg_to_rad = 3.14159265f / 180.0f;
-  const float sun_lo = (params.sun_elevation_deg - params.penumbra_deg) * deg_to_rad;
-  const float sun_hi = (params.sun_elevation_deg + params.penumbra_deg) * deg_to_rad;
-
+  const int div = std::max(1, params.resolution_divisor);
+  const int lw = (w + div - 1) / div, lh = (h + div - 1) / div;
+  const size_t ln = (size_t)lw * lh;
   const int dirs[8][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1},
                           {1, 1}, {-1, -1}, {1, -1}, {-1, 1}};
 
-  std::vector<float> angles;
-  std::vector<float> sky(n, 0.0f);
-  for (const auto &d : dirs) {
-    bool diagonal = d[0] != 0 && d[1] != 0;
-    sweep_horizon(H, w, h, d[0], d[1], diagonal ? diag_step : axis_step, angles);
-
-    for (size_t i = 0; i < n; ++i)
-      sky[i] += std::clamp(1.0f - std::sin(angles[i]), 0.0f, 1.0f);
-
-    if (d[0] == 1 && d[1] == 1) {
-
-      for (size_t i = 0; i < n; ++i) {
-        float vis;
-        if (sun_hi > sun_lo) {
-          float s = std::clamp((angles[i] - sun_lo) / (sun_hi - sun_lo), 0.0f, 1.0f);
-          vis = 1.0f - s * s * (3.0f - 2.0f * s);
-        } else {
-          vis = angles[i] < sun_lo ? 1.0f : 0.0f;
+  // A coarse sample stands in for its whole block as an occluder: the
+  // block's tallest height, reaching as far along each direction as the
+  // tallest pixels do (in pixels from the sample). Sampling only the centre
+  // drops hex edges that fall between samples and shortens every shadow.
+  std::vector<float> coarse_H;
+  std::vector<std::array<int8_t, 8>> block_reach;
+  std::vector<HorizonOccluder> occluders;
+  if (div > 1) {
+    coarse_H.resize(ln);
+    block_reach.resize(ln);
+    occluders.resize(ln);
+    for_each_band(ln, lw, tasks, [&](size_t l0, size_t l1) {
+      for (size_t l = l0; l < l1; ++l) {
+        const int lx = (int)(l % lw), ly = (int)(l / lw);
+        const size_t c = coarse_sample_pixel(lx, ly, div, w, h);
+        const int cx = (int)(c % w), cy = (int)(c / w);
+        const int x1 = std::min(w, lx * div + div), y1 = std::min(h, ly * div + div);
+        // Extent of the tallest pixels along each direction.
+        float top = -INFINITY;
+        std::array<int, 8> reach{};
+        for (int y = ly * div; y < y1; ++y) {
+          for (int x = lx * div; x < x1; ++x) {
+            float v = H[(size_t)y * w + x];
+            if (v < top)
+              continue;
+            for (int k = 0; k < 8; ++k) {
+              int r = (x - cx) * dirs[k][0] + (y - cy) * dirs[k][1];
+              reach[k] = v > top ? r : std::max(reach[k], r);
+            }
+            top = v;
+          }
         }
-        bake.rgba[i * 4 + 0] = (uint8_t)std::lround(vis * 255.0f);
+        coarse_H[l] = H[c];
+        occluders[l].height = top;
+        for (int k = 0; k < 8; ++k)
+          block_reach[l][k] = (int8_t)reach[k];
       }
+    });
+  }
+  const std::vector<float> &sweep_H = div > 1 ? coarse_H : H;
+
+  const float axis_step = div / params.pixels_per_unit;
+  const float diag_step = std::sqrt(2.0f) * div / params.pixels_per_unit;
+
+  // Directions are summed into `sky` in a fixed order, so the result is the
+  // same however the lines and bands are split across workers.
+  std::vector<float> angles;
+  std::vector<float> sky(ln, 0.0f);
+  for (int k = 0; k < 8; ++k) {
+    const int *d = dirs[k];
+    bool diagonal = d[0] != 0 && d[1] != 0;
+    if (div > 1) {
+      // Reach is a dot product with d, so diagonals are sqrt(2) too long.
+      const float scale = (diagonal ? std::sqrt(0.5f) : 1.0f) / params.pixels_per_unit;
+      for_each_band(ln, lw, tasks, [&](size_t i0, size_t i1) {
+        for (size_t i = i0; i < i1; ++i)
+          occluders[i].offset = block_reach[i][k] * scale;
+      });
     }
+    sweep_horizon(sweep_H, lw, lh, d[0], d[1], diagonal ? diag_step : axis_step, angles, tasks,
+                  div > 1 ? &occluders : nullptr);
+    for_each_band(ln, lw, tasks, [&](size_t i0, size_t i1) {
+      for (size_t i = i0; i < i1; ++i)
+        sky[i] += std::clamp(1.0f - std::sin(angles[i]), 0.0f, 1.0f);
+    });
+    if (d[0] == 1 && d[1] == 1)
+      hz.sun_angles = angles;
+  }
+
+  if (div > 1) {
+    const float sigma = UPSAMPLE_SIGMA * params.height_scale;
+    upsample_guided({&hz.sun_angles, &sky}, coarse_H, lw, lh, div, H, w, h, sigma, tasks);
   }
 
   const float inv_height_enc =
       1.0f / (params.height_scale * TERRAIN_LIGHT_HEIGHT_RANGE);
 
-  for (size_t i = 0; i < n; ++i) {
-    float sky_vis = std::clamp(sky[i] * (1.0f / 8.0f), 0.0f, 1.0f);
-    bake.rgba[i * 4 + 1] = (uint8_t)std::lround(sky_vis * 255.0f);
-    bake.rgba[i * 4 + 2] = (uint8_t)std::lround(
-        std::clamp(H[i] * inv_height_enc, 0.0f, 1.0f) * 255.0f);
-  }
+  hz.sky.resize(n);
+  auto heights = std::make_shared<std::vector<uint16_t>>(n);
+  for_each_band(n, w, tasks, [&](size_t i0, size_t i1) {
+    for (size_t i = i0; i < i1; ++i) {
+      float sky_vis = std::clamp(sky[i] * (1.0f / 8.0f), 0.0f, 1.0f);
+      hz.sky[i] = (uint8_t)std::lround(sky_vis * 255.0f);
+      (*heights)[i] = (uint16_t)std::lround(
+          std::clamp(H[i] * inv_height_enc, 0.0f, 1.0f) * 65535.0f);
+    }
+  });
+  hz.heights = std::move(heights);
+  return hz;
+}
+
+TerrainLightBake shade_terrain_light(const TerrainHorizons &horizons,
+                                     const TerrainLightParams &params,
+                                     TaskSystem *tasks) {
+  TerrainLightBake bake;
+  bake.width = horizons.width;
+  bake.height = horizons.height;
+  const size_t n = (size_t)bake.width * bake.height;
+  bake.heights = horizons.heights;
+  bake.rg.assign(n * 2, 255);
+  if (n == 0)
+    return bake;
+
+  const float deg_to_rad = 3.14159265f / 180.0f;
+  const float sun_lo = (params.sun_elevation_deg - params.penumbra_deg) * deg_to_rad;
+  const float sun_hi = (params.sun_elevation_deg + params.penumbra_deg) * deg_to_rad;
+  // A zero penumbra is a hard step at sun_lo.
+  const bool soft = sun_hi > sun_lo;
+  const float inv_span = soft ? 1.0f / (sun_hi - sun_lo) : 0.0f;
+
+  // Branch-free so the loop vectorizes; vis is in [0, 1], so adding a half
+  // and truncating rounds like lround.
+  const float *angles = horizons.sun_angles.data();
+  const uint8_t *sky = horizons.sky.data();
+  uint8_t *rg = bake.rg.data();
+  for_each_band(n, bake.width, tasks, [&](size_t i0, size_t i1) {
+    for (size_t i = i0; i < i1; ++i) {
+      float s = soft ? std::clamp((angles[i] - sun_lo) * inv_span, 0.0f, 1.0f)
+                     : (angles[i] < sun_lo ? 0.0f : 1.0f);
+      float vis = 1.0f - s * s * (3.0f - 2.0f * s);
+      rg[i * 2 + 0] = (uint8_t)(int)(vis * 255.0f + 0.5f);
+      rg[i * 2 + 1] = sky[i];
+    }
+  });
   return bake;
 }
+
+TerrainLightBake bake_terrain_lighting(const MapData &map,
+                                       const TerrainLightParams &params,
+                                       TaskSystem *tasks) {
+  return shade_terrain_light(sweep_terrain_horizons(map, params, tasks), params, tasks);
+}
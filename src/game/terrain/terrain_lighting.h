@@ -1,16 +1,24 @@
 #pragma once
 #include <cstdint>
+#include <memory>
 #include <vector>
 
 struct MapData;
+class TaskSystem;
 
 inline constexpr float TERRAIN_HORIZON_NONE = -1.5707963f;
 
 inline constexpr float TERRAIN_LIGHT_HEIGHT_RANGE = 1.25f;
 
+// Terrain height as R16 UNORM, in units of height_scale *
+// TERRAIN_LIGHT_HEIGHT_RANGE. Shared between bakes of the same horizons so
+// a reshade can leave the uploaded height texture alone.
+using TerrainLightHeights = std::shared_ptr<const std::vector<uint16_t>>;
+
 struct TerrainLightBake {
   int width = 0, height = 0;
-  std::vector<uint8_t> rgba;
+  std::vector<uint8_t> rg;  // R = sun visibility, G = sky visibility
+  TerrainLightHeights heights;
 };
 
 struct TerrainLightParams {
@@ -18,10 +26,48 @@ struct TerrainLightParams {
   float sun_elevation_deg = 55.0f;
   float penumbra_deg      = 6.0f;
   float pixels_per_unit   = 8.0f;
+  // Quality tier: 1 sweeps every pixel, 2 or 4 sweep a grid that much
+  // coarser and upsample it guided by the full-resolution heights.
+  int   resolution_divisor = 1;
+};
+
+// What a sample of a coarse sweep casts shadows with: the tallest height in
+// its block, standing at the tallest pixel's distance along the step from
+// the sample (world units, may be negative).
+struct HorizonOccluder {
+  float height, offset;
 };
 
+// Horizon angle towards (-step_dx, -step_dy) for every pixel, one convex
+// hull scan per line of pixels along the step; lines are split across
+// `tasks`. With per-sample `occluders` the hull is built from them and each
+// angle is measured from `heights` at its occluder's offset.
 void sweep_horizon(const std::vector<float> &heights, int width, int height,
                    int step_dx, int step_dy, float step_world_units,
-                   std::vector<float> &out_angles);
+                   std::vector<float> &out_angles, TaskSystem *tasks = nullptr,
+                   const std::vector<HorizonOccluder> *occluders = nullptr);
+
+// The sun-independent part of the bake: what the eight horizon sweeps
+// leave behind, so sun elevation and penumbra changes can reshade without
+// sweeping again. Depends on the heights, height_scale and pixels_per_unit.
+struct TerrainHorizons {
+  int width = 0, height = 0;
+  std::vector<float> sun_angles;  // horizon angle of the (1, 1) sweep
+  std::vector<uint8_t> sky;       // encoded sky visibility (bake G)
+  TerrainLightHeights heights;
+};
+
+// Sweeps eight directions one after another, each across `tasks`; the
+// result does not depend on the worker count. With a resolution_divisor
+// above 1 the angles and sky are swept coarse and upsampled to full size.
+TerrainHorizons sweep_terrain_horizons(const MapData &map, const TerrainLightParams &params = {},
+                                       TaskSystem *tasks = nullptr);
+
+// One pass over the cached horizons evaluating the sun term.
+TerrainLightBake shade_terrain_light(const TerrainHorizons &horizons,
+                                     const TerrainLightParams &params = {},
+                                     TaskSystem *tasks = nullptr);
 
-TerrainLightBake bake_terrain_lighting(const MapData &map, const TerrainLightParams &params = {});
+// sweep_terrain_horizons followed by shade_terrain_light.
+TerrainLightBake bake_terrain_lighting(const MapData &map, const TerrainLightParams &params = {},
+                                       TaskSystem *tasks = nullptr);
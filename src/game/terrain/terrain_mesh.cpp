@@ -18,13 +18,13 @@ static void color_to_float(uint32_t c, float &r, float &g, float &b) {
 }
 
 static void add_hex_top(const Vec2 corners[6], float z,
-                        float cr, float cg, float cb, float sheen,
+                        uint32_t column, float sheen,
                         TerrainMesh::RenderingLayer &layer) {
   uint32_t base = (uint32_t)layer.vertices.size();
   for (int i = 0; i < 6; ++i) {
     float wx = corners[i].x / Config::HEX_SIZE;
     float wy = corners[i].y / Config::HEX_SIZE;
-    layer.vertices.push_back({wx, wy, z, cr, cg, cb, sheen, 0.0f, 0.0f, 1.0f});
+    layer.vertices.push_back({wx, wy, z, column, sheen, 0.0f, 0.0f, 1.0f});
   }
   for (int i = 1; i <= 4; ++i) {
     layer.indices.push_back(base);
@@ -35,7 +35,7 @@ static void add_hex_top(const Vec2 corners[6], float z,
 
 static void add_side_face(const Vec2 &corner0, const Vec2 &corner1,
                           float top_height, float bottom_height,
-                          float cr, float cg, float cb, float sheen,
+                          uint32_t column, float sheen,
                           TerrainMesh::RenderingLayer &layer) {
   if (top_height - bottom_height < HEX_MIN_WALL_DROP)
     return;
@@ -57,10 +57,10 @@ static void add_side_face(const Vec2 &corner0, const Vec2 &corner1,
   float side_sheen = sheen * 0.4f;
 
   uint32_t base = (uint32_t)layer.vertices.size();
-  layer.vertices.push_back({wx0, wy0, top_height,    cr, cg, cb, side_sheen, nx, ny, 0.0f});
-  layer.vertices.push_back({wx1, wy1, top_height,    cr, cg, cb, side_sheen, nx, ny, 0.0f});
-  layer.vertices.push_back({wx1, wy1, bottom_height, cr, cg, cb, side_sheen, nx, ny, 0.0f});
-  layer.vertices.push_back({wx0, wy0, bottom_height, cr, cg, cb, side_sheen, nx, ny, 0.0f});
+  layer.vertices.push_back({wx0, wy0, top_height,    column, side_sheen, nx, ny, 0.0f});
+  layer.vertices.push_back({wx1, wy1, top_height,    column, side_sheen, nx, ny, 0.0f});
+  layer.vertices.push_back({wx1, wy1, bottom_height, column, side_sheen, nx, ny, 0.0f});
+  layer.vertices.push_back({wx0, wy0, bottom_height, column, side_sheen, nx, ny, 0.0f});
 
   layer.indices.push_back(base);
   layer.indices.push_back(base + 1);
@@ -70,8 +70,7 @@ static void add_side_face(const Vec2 &corner0, const Vec2 &corner1,
   layer.indices.push_back(base + 3);
 }
 
-TerrainMesh build_terrain_mesh(const TerrainState &terrain, const MapData &map_data,
-                               const ContourData &contours) {
+TerrainMesh build_terrain_mesh(const MapData &map_data, const ContourData &contours) {
   TerrainMesh mesh;
 
   const auto &columns    = map_data.columns;
@@ -82,44 +81,37 @@ TerrainMesh build_terrain_mesh(const TerrainState &terrain, const MapData &map_d
     return mesh;
   }
 
-  const Palette &palette = PALETTES[terrain.current_palette];
-
   mesh.basalt_layers.resize(2);
 
-  for (const auto &col : columns) {
-    uint32_t color = organic_color(col.base_height, col.q, col.r, palette);
-    float cr, cg, cb;
-    color_to_float(color, cr, cg, cb);
-
+  for (uint32_t c = 0; c < (uint32_t)columns.size(); ++c) {
+    if (!columns.edge_mask[c])
+      continue;
+    float height = columns.height[c];
     Vec2 corners[6];
-    get_hex_corners(col.q, col.r, Config::HEX_SIZE, corners);
+    get_hex_corners(columns.q[c], columns.r[c], Config::HEX_SIZE, corners);
 
     for (int i = 0; i < 6; ++i) {
-      if (col.visible_edges[i]) {
+      if (columns.edge_visible(c, i)) {
         int next = (i + 1) % 6;
-        float neighbor_height = col.height - col.edge_drops[i];
-        add_side_face(corners[i], corners[next], col.height, neighbor_height,
-                      cr, cg, cb, 1.0f, mesh.basalt_layers[0]);
+        float neighbor_height = height - columns.edge_drop[i][c];
+        add_side_face(corners[i], corners[next], height, neighbor_height,
+                      c, 1.0f, mesh.basalt_layers[0]);
       }
     }
   }
 
-  for (const auto &col : columns) {
-    uint32_t color = organic_color(col.base_height, col.q, col.r, palette);
-    float cr, cg, cb;
-    color_to_float(color, cr, cg, cb);
-
+  for (uint32_t c = 0; c < (uint32_t)columns.size(); ++c) {
     Vec2 corners[6];
-    get_hex_corners(col.q, col.r, Config::HEX_SIZE, corners);
+    get_hex_corners(columns.q[c], columns.r[c], Config::HEX_SIZE, corners);
 
-    add_hex_top(corners, col.height, cr, cg, cb, 1.0f, mesh.basalt_layers[1]);
+    add_hex_top(corners, columns.height[c], c, 1.0f, mesh.basalt_layers[1]);
   }
 
   SDL_Log("TerrainMesh: %zu side verts, %zu side indices, %zu top verts, %zu top indices",
           mesh.basalt_layers[0].vertices.size(), mesh.basalt_layers[0].indices.size(),
           mesh.basalt_layers[1].vertices.size(), mesh.basalt_layers[1].indices.size());
 
-  const float inv_unit = 1.0f / Config::HEX_SIZE;
+  const float inv_unit = 1.0f / map_data.pixels_per_unit;
   for (const auto &lava : lava_bodies) {
     uint32_t base_idx = (uint32_t)mesh.lava_vertices.size();
     for (const auto &v : lava.mesh.vertices) {
@@ -134,22 +126,46 @@ TerrainMesh build_terrain_mesh(const TerrainState &terrain, const MapData &map_d
   SDL_Log("TerrainMesh: %zu lava vertices, %zu lava indices",
           mesh.lava_vertices.size(), mesh.lava_indices.size());
 
-  for (const auto &line : contours.contour_lines) {
-    float wx0 = line.x1 * inv_unit;
-    float wy0 = line.y1 * inv_unit;
-    float wx1 = line.x2 * inv_unit;
-    float wy1 = line.y2 * inv_unit;
-    float z   = line.elevation;
-    mesh.contour_vertices.push_back({wx0, wy0, z});
-    mesh.contour_vertices.push_back({wx1, wy1, z});
+  const ContourStrips &strips = contours.contour_strips;
+  mesh.contour_vertices.reserve(strips.points.size());
+  mesh.contour_indices.reserve(2 * strips.segment_count());
+  for (size_t s = 0; s < strips.strip_count(); ++s) {
+    uint32_t begin = strips.strip_begin[s];
+    uint32_t end   = strips.strip_begin[s + 1];
+    float    z     = strips.elevations[s];
+    for (uint32_t i = begin; i < end; ++i) {
+      const ContourPoint &p = strips.points[i];
+      mesh.contour_vertices.push_back({p.x * inv_unit, p.y * inv_unit, z});
+    }
+    for (uint32_t i = begin; i + 1 < end; ++i) {
+      mesh.contour_indices.push_back(i);
+      mesh.contour_indices.push_back(i + 1);
+    }
+    if (strips.closed[s] && end - begin > 2) {
+      mesh.contour_indices.push_back(end - 1);
+      mesh.contour_indices.push_back(begin);
+    }
   }
 
-  SDL_Log("TerrainMesh: %zu contour vertices (%zu lines)",
-          mesh.contour_vertices.size(), contours.contour_lines.size());
+  SDL_Log("TerrainMesh: %zu contour vertices, %zu contour indices (%zu strips)",
+          mesh.contour_vertices.size(), mesh.contour_indices.size(), strips.strip_count());
 
   return mesh;
 }
 
+std::vector<GpuColumnColor> build_column_colors(const HexColumnsSoA &columns,
+                                                int palette) {
+  const Palette &pal = PALETTES[std::clamp(palette, 0, PALETTE_COUNT - 1)];
+  std::vector<GpuColumnColor> colors(columns.size());
+  for (size_t i = 0; i < columns.size(); ++i) {
+    GpuColumnColor &out = colors[i];
+    color_to_float(organic_color(columns.base_height[i], columns.q[i], columns.r[i], pal),
+                   out.r, out.g, out.b);
+    out.a = 1.0f;
+  }
+  return colors;
+}
+
 SceneUniforms compute_uniforms(const MapData &map_data,
                                const glm::mat4 &view, const glm::mat4 &projection,
                                uint32_t cluster_tiles_x, uint32_t cluster_tiles_y,
@@ -4,16 +4,22 @@
 #include <vector>
 #include <glm/glm.hpp>
 
-struct TerrainState;
 struct ContourData;
 
+// Colors are not baked into the vertices: `column` indexes the per-column
+// color buffer, so a palette swap only re-uploads that buffer.
 struct BasaltVertex {
   float pos_x, pos_y, pos_z;
-  float color_r, color_g, color_b;
+  uint32_t column;
   float sheen;
   float nx, ny, nz;
 };
 
+struct GpuColumnColor {
+  float r, g, b, a;
+};
+static_assert(sizeof(GpuColumnColor) == 16, "GpuColumnColor must be 16 bytes for std430");
+
 struct GpuLavaVertex {
   float pos_x, pos_y, pos_z;
   float time_offset;
@@ -62,10 +68,15 @@ struct TerrainMesh {
   std::vector<GpuLavaVertex>  lava_vertices;
   std::vector<uint32_t>       lava_indices;
   std::vector<ContourVertex>  contour_vertices;
+  std::vector<uint32_t>       contour_indices;  // line list over shared strip vertices
 };
 
-TerrainMesh build_terrain_mesh(const TerrainState &terrain, const MapData &map_data,
-                               const ContourData &contours);
+TerrainMesh build_terrain_mesh(const MapData &map_data, const ContourData &contours);
+
+// One entry per column, in map_data.columns order (the BasaltVertex::column
+// and instance index).
+std::vector<GpuColumnColor> build_column_colors(const HexColumnsSoA &columns,
+                                                int palette);
 
 SceneUniforms compute_uniforms(const MapData &map_data,
                                const glm::mat4 &view, const glm::mat4 &projection,
@@ -70,9 +70,11 @@ void TerrainRenderer::init(SDL_GPUDevice *device, SDL_Window *window, AssetManag
       SDL_GPU_BUFFERUSAGE_GRAPHICS_STORAGE_READ |
       SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_READ);
 
-  const uint8_t fully_lit_rgba[4] = { 0xFF, 0xFF, 0xFF, 0xFF };
-  light_fallback_tex = gpu_upload_texture_rgba8(device, fully_lit_rgba, 1, 1);
-  light_bake_smp     = gpu_create_linear_clamp_sampler(device);
+  const uint8_t  fully_lit_rg[2]   = { 0xFF, 0xFF };
+  const uint16_t zero_height[1]    = { 0 };
+  light_fallback_tex        = gpu_upload_texture_rg8(device, fully_lit_rg, 1, 1);
+  light_height_fallback_tex = gpu_upload_texture_r16(device, zero_height, 1, 1);
+  light_bake_smp            = gpu_create_linear_clamp_sampler(device);
 
   const uint8_t black_rgba[4] = { 0x00, 0x00, 0x00, 0xFF };
   fluence_fallback_tex = gpu_upload_texture_rgba8(device, black_rgba, 1, 1);
@@ -87,9 +89,9 @@ SDL_GPUGraphicsPipeline *TerrainRenderer::make_terrain_pipeline(
   const char *vk = pbr ? "pbr_static.vert" : "terrain.vert";
   const char *fk = pbr ? "pbr_static.frag" : "terrain.frag";
   SDL_GPUShader *vert = asset_manager->load_shader(
-      vk, shader_dir + "/" + vk + ".glsl.spv", SDL_GPU_SHADERSTAGE_VERTEX, 1, 0);
+      vk, shader_dir + "/" + vk + ".glsl.spv", SDL_GPU_SHADERSTAGE_VERTEX, 1, 1);
   SDL_GPUShader *frag = asset_manager->load_shader(
-      fk, shader_dir + "/" + fk + ".glsl.spv", SDL_GPU_SHADERSTAGE_FRAGMENT, 1, 3, 2);
+      fk, shader_dir + "/" + fk + ".glsl.spv", SDL_GPU_SHADERSTAGE_FRAGMENT, 1, 3, 3);
   if (!vert || !frag) return nullptr;
 
   SDL_GPUVertexBufferDescription vbuf_desc = {};
@@ -99,7 +101,7 @@ SDL_GPUGraphicsPipeline *TerrainRenderer::make_terrain_pipeline(
 
   SDL_GPUVertexAttribute attrs[4] = {};
   attrs[0] = { 0, 0, SDL_GPU_VERTEXELEMENTFORMAT_FLOAT3, (Uint32)offsetof(BasaltVertex, pos_x)   };
-  attrs[1] = { 1, 0, SDL_GPU_VERTEXELEMENTFORMAT_FLOAT3, (Uint32)offsetof(BasaltVertex, color_r) };
+  attrs[1] = { 1, 0, SDL_GPU_VERTEXELEMENTFORMAT_UINT,   (Uint32)offsetof(BasaltVertex, column)  };
   attrs[2] = { 2, 0, SDL_GPU_VERTEXELEMENTFORMAT_FLOAT,  (Uint32)offsetof(BasaltVertex, sheen)   };
   attrs[3] = { 3, 0, SDL_GPU_VERTEXELEMENTFORMAT_FLOAT3, (Uint32)offsetof(BasaltVertex, nx)      };
 
@@ -216,10 +218,10 @@ SDL_GPUGraphicsPipeline *TerrainRenderer::make_instanced_pipeline(
   std::string shader_dir = SHADER_DIR;
   SDL_GPUShader *vert = asset_manager->load_shader(
       "instanced_terrain.vert", shader_dir + "/instanced_terrain.vert.glsl.spv",
-      SDL_GPU_SHADERSTAGE_VERTEX, 1, 1);
+      SDL_GPU_SHADERSTAGE_VERTEX, 1, 2);
   SDL_GPUShader *frag = asset_manager->load_shader(
       "terrain.frag", shader_dir + "/terrain.frag.glsl.spv",
-      SDL_GPU_SHADERSTAGE_FRAGMENT, 1, 3, 2);
+      SDL_GPU_SHADERSTAGE_FRAGMENT, 1, 3, 3);
   if (!vert || !frag) return nullptr;
 
   SDL_GPUVertexBufferDescription vbuf_desc = {};
@@ -257,7 +259,10 @@ SDL_GPUGraphicsPipeline *TerrainRenderer::make_capture_pipeline(
     const char *vert_key, const char *frag_key, CaptureLayout layout,
     SDL_GPUTextureFormat color_format, SDL_GPUTextureFormat depth_format) {
   std::string shader_dir = SHADER_DIR;
-  int vert_storage = (layout == CaptureLayout::Instanced) ? 1 : 0;
+  // Basalt reads the column colors; instanced also reads its instances.
+  int vert_storage = layout == CaptureLayout::Instanced ? 2
+                   : layout == CaptureLayout::Basalt    ? 1
+                                                        : 0;
   SDL_GPUShader *vert = asset_manager->load_shader(
       vert_key, shader_dir + "/" + vert_key + ".glsl.spv",
       SDL_GPU_SHADERSTAGE_VERTEX, 1, vert_storage);
@@ -278,7 +283,7 @@ SDL_GPUGraphicsPipeline *TerrainRenderer::make_capture_pipeline(
     case CaptureLayout::Basalt:
       vbuf_desc.pitch = sizeof(BasaltVertex);
       attrs[0] = { 0, 0, SDL_GPU_VERTEXELEMENTFORMAT_FLOAT3, (Uint32)offsetof(BasaltVertex, pos_x)   };
-      attrs[1] = { 1, 0, SDL_GPU_VERTEXELEMENTFORMAT_FLOAT3, (Uint32)offsetof(BasaltVertex, color_r) };
+      attrs[1] = { 1, 0, SDL_GPU_VERTEXELEMENTFORMAT_UINT,   (Uint32)offsetof(BasaltVertex, column)  };
       attrs[2] = { 2, 0, SDL_GPU_VERTEXELEMENTFORMAT_FLOAT,  (Uint32)offsetof(BasaltVertex, sheen)   };
       attrs[3] = { 3, 0, SDL_GPU_VERTEXELEMENTFORMAT_FLOAT3, (Uint32)offsetof(BasaltVertex, nx)      };
       num_attrs = 4;
@@ -503,6 +508,7 @@ void TerrainRenderer::upload_mesh(SDL_GPUDevice *device, const TerrainMesh &mesh
   uint32_t lava_vbo_sz      = (uint32_t)(mesh.lava_vertices.size()           * sizeof(GpuLavaVertex));
   uint32_t lava_ibo_sz      = (uint32_t)(mesh.lava_indices.size()            * sizeof(uint32_t));
   uint32_t contour_vbo_sz   = (uint32_t)(mesh.contour_vertices.size()        * sizeof(ContourVertex));
+  uint32_t contour_ibo_sz   = (uint32_t)(mesh.contour_indices.size()         * sizeof(uint32_t));
 
   auto align4 = [](uint32_t v) { return (v + 3u) & ~3u; };
 
@@ -511,7 +517,8 @@ void TerrainRenderer::upload_mesh(SDL_GPUDevice *device, const TerrainMesh &mesh
   uint32_t off_lava_vbo    = off_basalt_ibo  + align4(basalt_ibo_sz);
   uint32_t off_lava_ibo    = off_lava_vbo    + align4(lava_vbo_sz);
   uint32_t off_contour_vbo = off_lava_ibo    + align4(lava_ibo_sz);
-  uint32_t total_sz        = off_contour_vbo + align4(contour_vbo_sz);
+  uint32_t off_contour_ibo = off_contour_vbo + align4(contour_vbo_sz);
+  uint32_t total_sz        = off_contour_ibo + align4(contour_ibo_sz);
 
   if (total_sz == 0) {
     has_data = false;
@@ -551,6 +558,7 @@ void TerrainRenderer::upload_mesh(SDL_GPUDevice *device, const TerrainMesh &mesh
   if (lava_vbo_sz)    SDL_memcpy(mapped + off_lava_vbo,    mesh.lava_vertices.data(),       lava_vbo_sz);
   if (lava_ibo_sz)    SDL_memcpy(mapped + off_lava_ibo,    mesh.lava_indices.data(),        lava_ibo_sz);
   if (contour_vbo_sz) SDL_memcpy(mapped + off_contour_vbo, mesh.contour_vertices.data(),    contour_vbo_sz);
+  if (contour_ibo_sz) SDL_memcpy(mapped + off_contour_ibo, mesh.contour_indices.data(),     contour_ibo_sz);
 
   SDL_UnmapGPUTransferBuffer(device, transfer);
 
@@ -566,9 +574,11 @@ void TerrainRenderer::upload_mesh(SDL_GPUDevice *device, const TerrainMesh &mesh
     lava_ibo          = gpu_create_buffer(device, lava_ibo_sz,    SDL_GPU_BUFFERUSAGE_INDEX);
     lava_index_count  = (uint32_t)mesh.lava_indices.size();
   }
-  if (contour_vbo_sz) {
+  if (contour_vbo_sz && contour_ibo_sz) {
     contour_vbo          = gpu_create_buffer(device, contour_vbo_sz, SDL_GPU_BUFFERUSAGE_VERTEX);
+    contour_ibo          = gpu_create_buffer(device, contour_ibo_sz, SDL_GPU_BUFFERUSAGE_INDEX);
     contour_vertex_count = (uint32_t)mesh.contour_vertices.size();
+    contour_index_count  = (uint32_t)mesh.contour_indices.size();
   }
 
   SDL_GPUCommandBuffer *cmd  = SDL_AcquireGPUCommandBuffer(device);
@@ -586,6 +596,7 @@ void TerrainRenderer::upload_mesh(SDL_GPUDevice *device, const TerrainMesh &mesh
   upload(lava_vbo,    off_lava_vbo,    lava_vbo_sz);
   upload(lava_ibo,    off_lava_ibo,    lava_ibo_sz);
   upload(contour_vbo, off_contour_vbo, contour_vbo_sz);
+  upload(contour_ibo, off_contour_ibo, contour_ibo_sz);
 
   SDL_EndGPUCopyPass(copy);
   SDL_SubmitGPUCommandBuffer(cmd);
@@ -599,12 +610,13 @@ void TerrainRenderer::upload_mesh(SDL_GPUDevice *device, const TerrainMesh &mesh
     if (lava_vbo)    asset_manager->register_buffer("lava_vbo",    lava_vbo);
     if (lava_ibo)    asset_manager->register_buffer("lava_ibo",    lava_ibo);
     if (contour_vbo) asset_manager->register_buffer("contour_vbo", contour_vbo);
+    if (contour_ibo) asset_manager->register_buffer("contour_ibo", contour_ibo);
   }
 
   has_data = true;
-  SDL_Log("TerrainRenderer: Mesh uploaded (basalt=%u idx, lava=%u verts/%u idx, contour=%u verts) staging=%u bytes",
+  SDL_Log("TerrainRenderer: Mesh uploaded (basalt=%u idx, lava=%u verts/%u idx, contour=%u verts/%u idx) staging=%u bytes",
           basalt_total_index_count, lava_vertex_count, lava_index_count,
-          contour_vertex_count, total_sz);
+          contour_vertex_count, contour_index_count, total_sz);
 }
 
 void TerrainRenderer::upload_gltf_column_mesh(SDL_GPUDevice *device,
@@ -624,15 +636,42 @@ void TerrainRenderer::upload_gltf_column_mesh(SDL_GPUDevice *device,
 }
 
 void TerrainRenderer::upload_light_bake(SDL_GPUDevice *device, const TerrainLightBake &bake) {
-  if (bake.width <= 0 || bake.height <= 0 || bake.rgba.empty()) return;
+  if (bake.width <= 0 || bake.height <= 0 || bake.rg.empty()) return;
 
   SDL_WaitForGPUIdle(device);
   if (light_bake_tex) { SDL_ReleaseGPUTexture(device, light_bake_tex); light_bake_tex = nullptr; }
 
-  light_bake_tex = gpu_upload_texture_rgba8(device, bake.rgba.data(),
-                                            (uint32_t)bake.width, (uint32_t)bake.height);
+  uint32_t w = (uint32_t)bake.width, h = (uint32_t)bake.height;
+  light_bake_tex = gpu_upload_texture_rg8(device, bake.rg.data(), w, h);
+  uint32_t bytes = w * h * 2;
+
+  // Heights are shared by every reshade of the same horizons; upload them
+  // only when they change.
+  if (bake.heights && bake.heights != light_heights) {
+    if (light_height_tex) { SDL_ReleaseGPUTexture(device, light_height_tex); light_height_tex = nullptr; }
+    light_height_tex = gpu_upload_texture_r16(device, bake.heights->data(), w, h);
+    light_heights    = bake.heights;
+    bytes += w * h * 2;
+  }
+
+  SDL_Log("TerrainRenderer: Light bake uploaded (%dx%d, %u bytes)", bake.width, bake.height, bytes);
+}
+
+void TerrainRenderer::upload_column_colors(SDL_GPUDevice *device,
+                                           const std::vector<GpuColumnColor> &colors) {
+  if (colors.empty()) return;
+
+  SDL_WaitForGPUIdle(device);
+  release_registered_buffer(device, column_color_ssbo, "column_color_ssbo");
 
-  SDL_Log("TerrainRenderer: Light bake uploaded (%dx%d)", bake.width, bake.height);
+  uint32_t byte_size = (uint32_t)(colors.size() * sizeof(GpuColumnColor));
+  column_color_ssbo = gpu_upload_buffer(device, colors.data(), byte_size,
+                                        SDL_GPU_BUFFERUSAGE_GRAPHICS_STORAGE_READ);
+  if (asset_manager && column_color_ssbo)
+    asset_manager->register_buffer("column_color_ssbo", column_color_ssbo);
+
+  SDL_Log("TerrainRenderer: Column colors uploaded (%zu columns, %.1f KB)",
+          colors.size(), byte_size / 1024.0f);
 }
 
 void TerrainRenderer::stage_instanced_draw(SDL_GPURenderPass *pass,
@@ -645,14 +684,15 @@ void TerrainRenderer::stage_instanced_draw(SDL_GPURenderPass *pass,
   SDL_PushGPUVertexUniformData(cmd, 0, &uniforms, sizeof(uniforms));
   SDL_PushGPUFragmentUniformData(cmd, 0, &uniforms, sizeof(uniforms));
 
-  SDL_GPUBuffer *vert_storage[1] = { instanced_terrain->get_instance_ssbo() };
-  SDL_BindGPUVertexStorageBuffers(pass, 0, vert_storage, 1);
+  SDL_GPUBuffer *vert_storage[2] = { instanced_terrain->get_instance_ssbo(), column_colors() };
+  SDL_BindGPUVertexStorageBuffers(pass, 0, vert_storage, 2);
 
-  SDL_GPUTextureSamplerBinding tsb[2] = {
-    { light_texture(),   light_sampler()   },
-    { fluence_texture(), fluence_sampler() },
+  SDL_GPUTextureSamplerBinding tsb[3] = {
+    { light_texture(),        light_sampler()   },
+    { light_height_texture(), light_sampler()   },
+    { fluence_texture(),      fluence_sampler() },
   };
-  SDL_BindGPUFragmentSamplers(pass, 0, tsb, 2);
+  SDL_BindGPUFragmentSamplers(pass, 0, tsb, 3);
 
   SDL_GPUBuffer *frag_storage[3] = {
     point_light_ssbo  ? point_light_ssbo  : dummy_ssbo,
@@ -851,11 +891,15 @@ void TerrainRenderer::stage_shaded_draw(SDL_GPURenderPass *pass,
     SDL_PushGPUFragmentUniformData(cmd, 0, &uniforms, sizeof(uniforms));
 
     {
-      SDL_GPUTextureSamplerBinding tsb[2] = {
-        { light_texture(),   light_sampler()   },
-        { fluence_texture(), fluence_sampler() },
+      SDL_GPUBuffer *vert_storage[1] = { column_colors() };
+      SDL_BindGPUVertexStorageBuffers(pass, 0, vert_storage, 1);
+
+      SDL_GPUTextureSamplerBinding tsb[3] = {
+        { light_texture(),        light_sampler()   },
+        { light_height_texture(), light_sampler()   },
+        { fluence_texture(),      fluence_sampler() },
       };
-      SDL_BindGPUFragmentSamplers(pass, 0, tsb, 2);
+      SDL_BindGPUFragmentSamplers(pass, 0, tsb, 3);
 
       SDL_GPUBuffer *frag_storage[3] = {
         point_light_ssbo  ? point_light_ssbo  : dummy_ssbo,
@@ -882,12 +926,14 @@ void TerrainRenderer::stage_shaded_draw(SDL_GPURenderPass *pass,
     SDL_DrawGPUIndexedPrimitives(pass, lava_index_count, 1, 0, 0, 0);
   }
 
-  if (contour_vbo && contour_vertex_count > 0 && contour_pipeline) {
+  if (contour_vbo && contour_ibo && contour_index_count > 0 && contour_pipeline) {
     SDL_BindGPUGraphicsPipeline(pass, contour_pipeline);
     SDL_PushGPUVertexUniformData(cmd, 0, &uniforms, sizeof(uniforms));
     SDL_GPUBufferBinding vbind = { contour_vbo, 0 };
+    SDL_GPUBufferBinding ibind = { contour_ibo, 0 };
     SDL_BindGPUVertexBuffers(pass, 0, &vbind, 1);
-    SDL_DrawGPUPrimitives(pass, contour_vertex_count, 1, 0, 0);
+    SDL_BindGPUIndexBuffer(pass, &ibind, SDL_GPU_INDEXELEMENTSIZE_32BIT);
+    SDL_DrawGPUIndexedPrimitives(pass, contour_index_count, 1, 0, 0, 0);
   }
 }
 
@@ -901,8 +947,8 @@ void TerrainRenderer::draw_capture(SDL_GPURenderPass *pass,
     SDL_BindGPUGraphicsPipeline(pass, capture_instanced_pipeline);
     SDL_PushGPUVertexUniformData(cmd, 0, &uniforms, sizeof(uniforms));
 
-    SDL_GPUBuffer *vert_storage[1] = { instanced_terrain->get_instance_ssbo() };
-    SDL_BindGPUVertexStorageBuffers(pass, 0, vert_storage, 1);
+    SDL_GPUBuffer *vert_storage[2] = { instanced_terrain->get_instance_ssbo(), column_colors() };
+    SDL_BindGPUVertexStorageBuffers(pass, 0, vert_storage, 2);
 
     SDL_GPUBufferBinding vbind = { gltf_column_vbo, 0 };
     SDL_GPUBufferBinding ibind = { gltf_column_ibo, 0 };
@@ -914,6 +960,9 @@ void TerrainRenderer::draw_capture(SDL_GPURenderPass *pass,
     SDL_BindGPUGraphicsPipeline(pass, capture_terrain_pipeline);
     SDL_PushGPUVertexUniformData(cmd, 0, &uniforms, sizeof(uniforms));
 
+    SDL_GPUBuffer *vert_storage[1] = { column_colors() };
+    SDL_BindGPUVertexStorageBuffers(pass, 0, vert_storage, 1);
+
     SDL_GPUBufferBinding vbind = { basalt_vbo, 0 };
     SDL_GPUBufferBinding ibind = { basalt_ibo, 0 };
     SDL_BindGPUVertexBuffers(pass, 0, &vbind, 1);
@@ -1027,6 +1076,7 @@ void TerrainRenderer::release_buffers(SDL_GPUDevice *device) {
   release_registered_buffer(device, lava_vbo,    "lava_vbo");
   release_registered_buffer(device, lava_ibo,    "lava_ibo");
   release_registered_buffer(device, contour_vbo, "contour_vbo");
+  release_registered_buffer(device, contour_ibo, "contour_ibo");
   has_data = false;
 }
 
@@ -1045,6 +1095,7 @@ void TerrainRenderer::cleanup(SDL_GPUDevice *device) {
   SDL_WaitForGPUIdle(device);
 
   release_buffers(device);
+  release_registered_buffer(device, column_color_ssbo, "column_color_ssbo");
   if (gltf_column_vbo) { SDL_ReleaseGPUBuffer(device, gltf_column_vbo); gltf_column_vbo = nullptr; }
   if (gltf_column_ibo) { SDL_ReleaseGPUBuffer(device, gltf_column_ibo); gltf_column_ibo = nullptr; }
   gltf_column_index_count = 0;
@@ -1054,6 +1105,9 @@ void TerrainRenderer::cleanup(SDL_GPUDevice *device) {
   if (depth_texture)            { SDL_ReleaseGPUTexture(device, depth_texture);                        depth_texture            = nullptr; }
   if (light_bake_tex)           { SDL_ReleaseGPUTexture(device, light_bake_tex);                       light_bake_tex           = nullptr; }
   if (light_fallback_tex)       { SDL_ReleaseGPUTexture(device, light_fallback_tex);                   light_fallback_tex       = nullptr; }
+  if (light_height_tex)         { SDL_ReleaseGPUTexture(device, light_height_tex);                     light_height_tex         = nullptr; }
+  if (light_height_fallback_tex){ SDL_ReleaseGPUTexture(device, light_height_fallback_tex);            light_height_fallback_tex = nullptr; }
+  light_heights.reset();
   if (light_bake_smp)           { SDL_ReleaseGPUSampler(device, light_bake_smp);                       light_bake_smp           = nullptr; }
   if (fluence_fallback_tex)     { SDL_ReleaseGPUTexture(device, fluence_fallback_tex);                 fluence_fallback_tex     = nullptr; }
   rc_fluence_tex = nullptr;
@@ -21,6 +21,9 @@ public:
                                 uint32_t index_count);
   void rebuild_dirty_pipelines(SDL_Window *window);
   void upload_light_bake(SDL_GPUDevice *device, const TerrainLightBake &bake);
+  // Indexed by BasaltVertex::column and the instance index. Kept apart from
+  // the mesh so a palette change only replaces this buffer.
+  void upload_column_colors(SDL_GPUDevice *device, const std::vector<GpuColumnColor> &colors);
 
   void draw(SDL_GPUCommandBuffer *cmd,
             SDL_GPUTexture *swapchain,
@@ -52,8 +55,13 @@ public:
   SDL_GPUBuffer           *get_light_grid_ssbo()   const { return light_grid_ssbo;   }
   SDL_GPUBuffer           *get_global_index_ssbo() const { return global_index_ssbo; }
 
+  SDL_GPUBuffer  *column_colors() const { return column_color_ssbo ? column_color_ssbo : dummy_ssbo; }
+
   SDL_GPUTexture *light_texture() const { return light_bake_tex ? light_bake_tex : light_fallback_tex; }
   SDL_GPUSampler *light_sampler() const { return light_bake_smp; }
+  SDL_GPUTexture *light_height_texture() const {
+    return light_height_tex ? light_height_tex : light_height_fallback_tex;
+  }
 
   SDL_GPUTexture *fluence_texture() const { return rc_fluence_tex ? rc_fluence_tex : fluence_fallback_tex; }
   SDL_GPUSampler *fluence_sampler() const { return rc_fluence_smp ? rc_fluence_smp : light_bake_smp; }
@@ -145,6 +153,10 @@ private:
 
   SDL_GPUBuffer *contour_vbo    = nullptr;
   uint32_t       contour_vertex_count = 0;
+  SDL_GPUBuffer *contour_ibo    = nullptr;
+  uint32_t       contour_index_count  = 0;
+
+  SDL_GPUBuffer *column_color_ssbo = nullptr;
 
   SDL_GPUBuffer *gltf_column_vbo         = nullptr;
   SDL_GPUBuffer *gltf_column_ibo         = nullptr;
@@ -162,6 +174,9 @@ private:
   SDL_GPUTexture *light_bake_tex     = nullptr;
   SDL_GPUTexture *light_fallback_tex = nullptr;
   SDL_GPUSampler *light_bake_smp     = nullptr;
+  SDL_GPUTexture *light_height_tex          = nullptr;
+  SDL_GPUTexture *light_height_fallback_tex = nullptr;
+  TerrainLightHeights light_heights;  // what light_height_tex was uploaded from
 
   SDL_GPUTexture *rc_fluence_tex       = nullptr;
   SDL_GPUSampler *rc_fluence_smp       = nullptr;
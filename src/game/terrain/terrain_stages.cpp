@@ -0,0 +1,178 @@
+#include "terrain/terrain_stages.h"
+#include "terrain/basalt.h"
+#include "terrain/contour.h"
+#include "terrain/lava.h"
+#include <type_traits>
+
+namespace {
+
+// FNV-1a over the raw bytes of each added value; only used with types
+// that have no padding.
+struct KeyHasher {
+  uint64_t hash = 14695981039346656037ULL;
+
+  template <typename T> KeyHasher &add(const T &value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&value);
+    for (size_t i = 0; i < sizeof(T); ++i) {
+      hash ^= bytes[i];
+      hash *= 1099511628211ULL;
+    }
+    return *this;
+  }
+};
+
+TerrainLightParams stage_light_params(const TerrainStageInputs &in) {
+  TerrainLightParams light = in.light;
+  light.pixels_per_unit = in.pixels_per_unit;
+  return light;
+}
+
+} // namespace
+
+void TerrainStageGraph::compute_keys(const TerrainStageInputs &in,
+                                     uint64_t out[STAGE_COUNT]) {
+  out[COMPOSE] = KeyHasher()
+                     .add(in.width)
+                     .add(in.height)
+                     .add(in.elev)
+                     .add(in.river)
+                     .add(in.worley)
+                     .add(in.comp.terrace_levels)
+                     .add(in.comp.min_region_size)
+                     .add(in.comp.keep_edge_regions)
+                     .add(in.comp.max_region_extent)
+                     .hash;
+  out[BASALT] = KeyHasher().add(out[COMPOSE]).add(in.pixels_per_unit).hash;
+  out[LAVA] = KeyHasher()
+                  .add(out[BASALT])
+                  .add(in.comp.void_chance)
+                  .add(in.worley.seed)
+                  .hash;
+  TerrainLightParams light = stage_light_params(in);
+  out[HORIZONS] = KeyHasher()
+                      .add(out[BASALT])
+                      .add(light.height_scale)
+                      .add(light.pixels_per_unit)
+                      .add(light.resolution_divisor)
+                      .hash;
+  out[LIGHT] = KeyHasher()
+                   .add(out[HORIZONS])
+                   .add(light.sun_elevation_deg)
+                   .add(light.penumbra_deg)
+                   .hash;
+  out[CONTOURS] = KeyHasher().add(out[COMPOSE]).add(in.pixels_per_unit).hash;
+  out[MESH] = KeyHasher().add(out[LAVA]).add(out[CONTOURS]).hash;
+  out[COLORS] = KeyHasher().add(out[BASALT]).add(in.terrain.current_palette).hash;
+}
+
+bool TerrainStageGraph::stale(const TerrainStageInputs &in, Stage stage) const {
+  uint64_t k[STAGE_COUNT];
+  compute_keys(in, k);
+  return !valid[stage] || keys[stage] != k[stage];
+}
+
+bool TerrainStageGraph::run(const TerrainStageInputs &in, NoiseCache *cache,
+                            TaskSystem *tasks,
+                            const std::function<bool()> &should_abort,
+                            TerrainStageOutputs &out) {
+  uint64_t k[STAGE_COUNT];
+  compute_keys(in, k);
+  auto dirty = [&](Stage s) { return !valid[s] || keys[s] != k[s]; };
+  auto done = [&](Stage s) {
+    keys[s] = k[s];
+    valid[s] = true;
+    ++runs[s];
+  };
+
+  if (dirty(COMPOSE)) {
+    auto md = std::make_shared<MapData>();
+    md->allocate(in.width, in.height);
+    md->pixels_per_unit = in.pixels_per_unit;
+    compose_layers(*md, in.elev, in.river, in.worley, in.comp, cache, tasks);
+    if (should_abort()) return false;
+    composed = std::move(md);
+    done(COMPOSE);
+  }
+
+  if (dirty(BASALT)) {
+    auto md = std::make_shared<MapData>(*composed);
+    md->columns = generate_basalt_columns_v2(*md, in.pixels_per_unit, {}, tasks);
+    if (should_abort()) return false;
+    with_columns = std::move(md);
+    done(BASALT);
+  }
+
+  // The lava map and contours are handed out with the mesh built from them,
+  // so rebuilding the mesh after that needs them recomputed.
+  if (dirty(MESH) && !with_lava)
+    valid[LAVA] = false;
+  if (dirty(MESH) && !contours)
+    valid[CONTOURS] = false;
+
+  if (dirty(LAVA)) {
+    auto md = std::make_shared<MapData>(*with_columns);
+    auto fill = generate_lava_and_void(*md, in.comp.void_chance, in.worley.seed, tasks);
+    if (should_abort()) return false;
+    md->lava_bodies = std::move(fill.lava_bodies);
+    md->void_bodies = std::move(fill.void_bodies);
+    with_lava = std::move(md);
+    done(LAVA);
+  }
+
+  if (dirty(HORIZONS)) {
+    auto hz = std::make_shared<const TerrainHorizons>(
+        sweep_terrain_horizons(*with_columns, stage_light_params(in), tasks));
+    if (should_abort()) return false;
+    horizons = std::move(hz);
+    done(HORIZONS);
+  }
+
+  if (dirty(LIGHT)) {
+    auto bake = std::make_shared<const TerrainLightBake>(
+        shade_terrain_light(*horizons, stage_light_params(in), tasks));
+    if (should_abort()) return false;
+    light_bake = std::move(bake);
+    done(LIGHT);
+  }
+
+  if (dirty(CONTOURS)) {
+    auto cd = std::make_shared<ContourData>();
+    cd->heightmap = *composed->basalt_height;
+    std::vector<Line> lines;
+    extract_contours(cd->heightmap, in.width, in.height,
+                     1.0f / in.comp.terrace_levels, lines, cd->band_map, tasks);
+    cd->contour_strips =
+        stitch_contours(lines, Config::CONTOUR_TOLERANCE * in.pixels_per_unit, tasks);
+    if (should_abort()) return false;
+    contours = std::move(cd);
+    done(CONTOURS);
+  }
+
+  bool mesh_built = false;
+  if (dirty(MESH)) {
+    auto m = std::make_shared<const TerrainMesh>(build_terrain_mesh(*with_lava, *contours));
+    if (should_abort()) return false;
+    mesh = std::move(m);
+    done(MESH);
+    mesh_built = true;
+  }
+
+  if (dirty(COLORS)) {
+    column_colors = std::make_shared<const std::vector<GpuColumnColor>>(
+        build_column_colors(with_columns->columns, in.terrain.current_palette));
+    done(COLORS);
+  }
+
+  out.map = mesh_built ? std::move(with_lava) : nullptr;
+  out.contours = mesh_built ? std::move(contours) : nullptr;
+  out.light_bake = light_bake;
+  out.mesh = mesh;
+  out.column_colors = column_colors;
+  return true;
+}
+
+void TerrainStageGraph::invalidate() {
+  for (bool &v : valid)
+    v = false;
+}
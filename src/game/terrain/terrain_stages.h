@@ -0,0 +1,75 @@
+#pragma once
+#include "game_state.h"
+#include "terrain/noise_composer.h"
+#include "terrain/terrain_lighting.h"
+#include "terrain/terrain_mesh.h"
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+class TaskSystem;
+
+struct TerrainStageInputs {
+  int width = Config::MAP_WIDTH;
+  int height = Config::MAP_HEIGHT;
+  float pixels_per_unit = Config::HEX_SIZE;
+  ElevationParams elev;
+  RiverParams river;
+  WorleyParams worley;
+  CompositionParams comp;
+  TerrainState terrain;
+  TerrainLightParams light;
+};
+
+struct TerrainStageOutputs {
+  // Only set by runs that rebuilt the mesh. The mesh is their last reader in
+  // the graph, so the caller owns them outright and may move from them.
+  std::shared_ptr<MapData> map;
+  std::shared_ptr<ContourData> contours;
+  std::shared_ptr<const TerrainLightBake> light_bake;
+  std::shared_ptr<const TerrainMesh> mesh;
+  std::shared_ptr<const std::vector<GpuColumnColor>> column_colors;
+};
+
+// The terrain pipeline as a stage graph:
+//
+//   compose -> basalt -> lava -----------------> mesh
+//      |          |--> horizons -> light        ^
+//      |          \--> colors                   |
+//      \--> contours ---------------------------/
+//
+// Each stage's key hashes the parameters it reads together with the keys of
+// its inputs. Outputs are kept between runs and a stage only executes when
+// its key changed, so e.g. a sun-angle tweak just reshades the cached
+// horizons and a palette swap only recolors. Each stage copies only what it
+// changes; the rasters compose produces are shared by every later map.
+class TerrainStageGraph {
+public:
+  enum Stage { COMPOSE, BASALT, LAVA, HORIZONS, LIGHT, CONTOURS, MESH, COLORS, STAGE_COUNT };
+
+  // Returns false when should_abort fired; stages finished so far stay cached.
+  bool run(const TerrainStageInputs &in, NoiseCache *cache, TaskSystem *tasks,
+           const std::function<bool()> &should_abort, TerrainStageOutputs &out);
+
+  // True if the next run with these inputs would execute `stage`.
+  bool stale(const TerrainStageInputs &in, Stage stage) const;
+
+  void invalidate();
+  int run_count(Stage stage) const { return runs[stage]; }
+
+private:
+  static void compute_keys(const TerrainStageInputs &in, uint64_t out[STAGE_COUNT]);
+
+  uint64_t keys[STAGE_COUNT] = {};
+  bool valid[STAGE_COUNT] = {};
+  int runs[STAGE_COUNT] = {};
+
+  std::shared_ptr<const MapData> composed;
+  std::shared_ptr<const MapData> with_columns;
+  std::shared_ptr<MapData> with_lava;
+  std::shared_ptr<const TerrainHorizons> horizons;
+  std::shared_ptr<const TerrainLightBake> light_bake;
+  std::shared_ptr<ContourData> contours;
+  std::shared_ptr<const TerrainMesh> mesh;
+  std::shared_ptr<const std::vector<GpuColumnColor>> column_colors;
+};
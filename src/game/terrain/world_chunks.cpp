@@ -0,0 +1,177 @@
+#include "terrain/world_chunks.h"
+#include "terrain/basalt.h"
+#include "terrain/contour.h"
+#include "core/task_system.h"
+#include <SDL3/SDL.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+template <typename T>
+static std::vector<T> crop(const std::vector<T> &src, int src_width, int x0,
+                           int y0, int width, int height) {
+  std::vector<T> out((size_t)width * height);
+  for (int y = 0; y < height; ++y) {
+    auto row = src.begin() + (size_t)(y0 + y) * src_width + x0;
+    std::copy(row, row + width, out.begin() + (size_t)y * width);
+  }
+  return out;
+}
+
+template <typename T>
+static std::shared_ptr<const std::vector<T>>
+crop_layer(const std::shared_ptr<const std::vector<T>> &src, int src_width,
+           int x0, int y0, int width, int height) {
+  return std::make_shared<const std::vector<T>>(crop(*src, src_width, x0, y0, width, height));
+}
+
+// Pixels past the interior whose heights still feed a chunk: neighbouring
+// columns for edge visibility, their jitter and the bilinear footprint.
+static constexpr int CLEANUP_REACH = (int)(2 * Config::HEX_SIZE) + 2;
+
+void ChunkedWorld::configure(const ChunkedWorldParams &params,
+                             const ElevationParams &elev_params,
+                             const RiverParams &river_params,
+                             const WorleyParams &worley_params,
+                             const CompositionParams &comp_params) {
+  world_params = params;
+  elev = elev_params;
+  river = river_params;
+  worley = worley_params;
+  comp = comp_params;
+
+  // Region cleanup keeps or drops each region as a whole. Only regions no
+  // wider or taller than what the halo holds beyond CLEANUP_REACH (less the
+  // raster's outermost pixel ring, which elevation leaves at zero) may go:
+  // every chunk that keeps a pixel of one sees it whole, with the same
+  // border, and decides it the same way. Larger regions are cut by some
+  // halo, so all chunks keep them.
+  comp.keep_edge_regions = true;
+  comp.max_region_extent =
+      std::min(comp.max_region_extent, std::max(0, params.halo - CLEANUP_REACH - 1));
+  chunks.clear();
+
+  // Noise statistics are stationary, so a window a few chunks across gives
+  // ranges that every chunk can share without visible clipping.
+  const int ref = params.chunk_size * 2;
+  RiverParams river_ref = river;
+  river_ref.map_scale = elev.map_scale;
+  river_ref.origin_x = river_ref.origin_y = -ref / 2;
+  WorleyParams worley_ref = worley;
+  worley_ref.map_scale = elev.map_scale;
+  worley_ref.origin_x = worley_ref.origin_y = -ref / 2;
+
+  noise_ranges = {};
+  std::vector<float> scratch, edge, cell;
+  generate_river_mask(scratch, ref, ref, river_ref, &noise_ranges.river);
+  generate_worley_layer(scratch, edge, cell, ref, ref, worley_ref, nullptr,
+                        &noise_ranges);
+}
+
+ChunkCoord ChunkedWorld::chunk_at(float world_x, float world_y) const {
+  const float size = (float)world_params.chunk_size;
+  return {(int)std::floor(world_x * Config::HEX_SIZE / size),
+          (int)std::floor(world_y * Config::HEX_SIZE / size)};
+}
+
+WorldChunk ChunkedWorld::generate(ChunkCoord coord, TaskSystem *tasks) const {
+  const int size = world_params.chunk_size;
+  const int halo = world_params.halo;
+  const int padded = size + 2 * halo;
+  const int org_x = coord.x * size;
+  const int org_y = coord.y * size;
+
+  MapData raw;
+  raw.allocate(padded, padded);
+  raw.origin_x = org_x - halo;
+  raw.origin_y = org_y - halo;
+
+  NoiseRanges ranges = noise_ranges;
+  compose_layers(raw, elev, river, worley, comp, nullptr, tasks, &ranges);
+
+  WorldChunk chunk;
+  chunk.coord = coord;
+  MapData &md = chunk.map;
+
+  // Columns are placed and edge-tested against the haloed raster; each chunk
+  // keeps the ones whose centre falls in its interior.
+  HexColumnsSoA placed = generate_basalt_columns_v2(raw, raw.pixels_per_unit, {}, tasks);
+  for (size_t i = 0; i < placed.size(); ++i) {
+    float cx, cy;
+    hex_to_pixel(placed.q[i], placed.r[i], raw.pixels_per_unit, cx, cy);
+    if (cx >= org_x && cx < org_x + size && cy >= org_y && cy < org_y + size)
+      md.columns.push_back(placed, i);
+  }
+
+  // Contours span one extra sample row and column so the marching squares
+  // between this chunk and its +x/+y neighbours are emitted exactly once.
+  std::vector<float> window = crop(*raw.basalt_height, padded, halo, halo, size + 1, size + 1);
+  std::vector<int> window_bands;
+  std::vector<Line> window_lines;
+  extract_contours(window, size + 1, size + 1, 1.0f / comp.terrace_levels,
+                   window_lines, window_bands, tasks);
+  md.contour_strips =
+      stitch_contours(window_lines, Config::CONTOUR_TOLERANCE * raw.pixels_per_unit, tasks);
+  for (ContourPoint &p : md.contour_strips.points) {
+    p.x += org_x;
+    p.y += org_y;
+  }
+
+  md.width = size;
+  md.height = size;
+  md.origin_x = org_x;
+  md.origin_y = org_y;
+  md.elevation = crop_layer(raw.elevation, padded, halo, halo, size, size);
+  md.river_mask = crop_layer(raw.river_mask, padded, halo, halo, size, size);
+  md.worley = crop_layer(raw.worley, padded, halo, halo, size, size);
+  md.worley_edge = crop_layer(raw.worley_edge, padded, halo, halo, size, size);
+  md.worley_cell_value = crop_layer(raw.worley_cell_value, padded, halo, halo, size, size);
+  md.worley_cell_id = crop_layer(raw.worley_cell_id, padded, halo, halo, size, size);
+  md.final_elevation = md.elevation;
+  md.liquid_mask = crop_layer(raw.liquid_mask, padded, halo, halo, size, size);
+  md.basalt_height = crop_layer(raw.basalt_height, padded, halo, halo, size, size);
+  md.terrain_map = crop(raw.terrain_map, padded, halo, halo, size, size);
+  md.band_map = crop(window_bands, size + 1, 0, 0, size, size);
+  return chunk;
+}
+
+int ChunkedWorld::update(float cam_world_x, float cam_world_y, TaskSystem *tasks) {
+  const ChunkCoord center = chunk_at(cam_world_x, cam_world_y);
+  const int radius = world_params.load_radius;
+
+  for (auto it = chunks.begin(); it != chunks.end();) {
+    const ChunkCoord c = it->first;
+    if (std::abs(c.x - center.x) > radius + 1 || std::abs(c.y - center.y) > radius + 1)
+      it = chunks.erase(it);
+    else
+      ++it;
+  }
+
+  std::vector<ChunkCoord> missing;
+  for (int dy = -radius; dy <= radius; ++dy)
+    for (int dx = -radius; dx <= radius; ++dx) {
+      ChunkCoord c{center.x + dx, center.y + dy};
+      if (!chunks.count(c))
+        missing.push_back(c);
+    }
+  if (missing.empty())
+    return 0;
+
+  std::vector<std::unique_ptr<WorldChunk>> built(missing.size());
+  auto build = [&](int i) {
+    built[i] = std::make_unique<WorldChunk>(generate(missing[i]));
+  };
+  TaskSystem::run(tasks, (int)missing.size(), build);
+
+  for (size_t i = 0; i < missing.size(); ++i)
+    chunks[missing[i]] = std::move(built[i]);
+
+  SDL_Log("ChunkedWorld: generated %zu chunks around (%d, %d), %zu loaded",
+          missing.size(), center.x, center.y, chunks.size());
+  return (int)missing.size();
+}
+
+const WorldChunk *ChunkedWorld::find(ChunkCoord coord) const {
+  auto it = chunks.find(coord);
+  return it == chunks.end() ? nullptr : it->second.get();
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include "terrain/map_data.h"
+#include "terrain/noise_composer.h"
+#include "terrain/util.h"
+#include <memory>
+#include <unordered_map>
+
+class TaskSystem;
+
+struct ChunkCoord {
+  int x, y;
+  bool operator==(const ChunkCoord &o) const { return x == o.x && y == o.y; }
+};
+
+struct ChunkCoordHash {
+  size_t operator()(const ChunkCoord &c) const { return hash2d(c.x, c.y); }
+};
+
+struct ChunkedWorldParams {
+  int chunk_size = 256;  // interior pixels per side
+  int halo = 64;         // generated around the interior, then discarded;
+                         // also bounds the regions cleanup may remove
+  int load_radius = 1;   // rings of chunks kept around the camera chunk
+};
+
+// One tile of an unbounded world. The map covers only the interior and is
+// placed by origin_x/origin_y; columns carry world q/r and contour points are
+// in world pixels, so chunks feed build_terrain_mesh unchanged. Lava and void
+// bodies are flood-filled over whole plateaus and are not generated here.
+struct WorldChunk {
+  ChunkCoord coord;
+  MapData map;
+};
+
+// Generates and streams chunks around a camera. This is generation-side
+// infrastructure only: TopoGame still builds and renders one fixed map, and
+// nothing draws chunks yet.
+class ChunkedWorld {
+public:
+  // Snapshots the generation parameters and measures the shared noise
+  // normalisation on a reference window around the world origin. Small-region
+  // cleanup keeps min_region_size but only removes regions narrow enough for
+  // the halo to show them whole to every chunk; see composition().
+  void configure(const ChunkedWorldParams &params, const ElevationParams &elev,
+                 const RiverParams &river, const WorleyParams &worley,
+                 const CompositionParams &comp);
+
+  // Generates the chunks within load_radius of the camera and unloads those
+  // more than one ring further out. Returns the number of chunks generated.
+  int update(float cam_world_x, float cam_world_y, TaskSystem *tasks = nullptr);
+
+  WorldChunk generate(ChunkCoord coord, TaskSystem *tasks = nullptr) const;
+
+  const WorldChunk *find(ChunkCoord coord) const;
+  size_t loaded_count() const { return chunks.size(); }
+  const ChunkedWorldParams &params() const { return world_params; }
+  const NoiseRanges &ranges() const { return noise_ranges; }
+  // The composition parameters chunks are generated with, including the
+  // max_region_extent that the halo allows.
+  const CompositionParams &composition() const { return comp; }
+
+  ChunkCoord chunk_at(float world_x, float world_y) const;
+
+private:
+  ChunkedWorldParams world_params;
+  ElevationParams elev;
+  RiverParams river;
+  WorleyParams worley;
+  CompositionParams comp;
+  NoiseRanges noise_ranges;
+  std::unordered_map<ChunkCoord, std::unique_ptr<WorldChunk>, ChunkCoordHash> chunks;
+};
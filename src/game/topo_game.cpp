@@ -17,6 +17,7 @@
 #include <glm/gtc/constants.hpp>
 #include <algorithm>
 #include <cmath>
+#include <thread>
 
 using json = nlohmann::json;
 
@@ -32,7 +33,8 @@ static json params_to_json(const ElevationParams &elev,
     {"worley", {
       {"frequency",      worley.frequency},
       {"jitter",         worley.jitter},       {"warp_amp",       worley.warp_amp},
-      {"warp_frequency", worley.warp_frequency},{"warp_octaves",  worley.warp_octaves}
+      {"warp_frequency", worley.warp_frequency},{"warp_octaves",  worley.warp_octaves},
+      {"warp_lattice_step", worley.warp_lattice_step}
     }},
     {"composition", {
       {"void_chance",    comp.void_chance},
@@ -63,6 +65,8 @@ static void json_to_params(const json &j, ElevationParams &elev,
   worley.warp_amp       = w.value("warp_amp",       worley.warp_amp);
   worley.warp_frequency = w.value("warp_frequency", worley.warp_frequency);
   worley.warp_octaves   = w.value("warp_octaves",   worley.warp_octaves);
+  worley.warp_lattice_step =
+      std::clamp(w.value("warp_lattice_step", worley.warp_lattice_step), 1, 16);
 
   const json c = j.value("composition", json::object());
   comp.void_chance     = c.value("void_chance",     comp.void_chance);
@@ -86,7 +90,8 @@ void TopoGame::on_init(GpuContext &gpu, flecs::world &ecs) {
   ecs.set<MapData>({});
   ecs.set<ContourData>({});
 
-  task_system.init(1);
+  task_system.init((int)std::max(1u, std::thread::hardware_concurrency()));
+  async_terrain.async_cache.set_disk_dir("noise_cache");
 
   input.init();
 
@@ -198,27 +203,27 @@ void TopoGame::on_pre_frame_game(GpuContext &gpu, flecs::world &ecs) {
                                    tilesY != terrain_renderer.cluster_tiles_y());
   }
 
-  if (ready_mesh_pending || needs_depth_rebuild_early || needs_cluster_rebuild_early) {
+  if (ready_mesh_pending || ready_light_bake_pending || ready_column_colors_pending ||
+      needs_depth_rebuild_early || needs_cluster_rebuild_early) {
     SDL_WaitForGPUIdle(gpu.device);
   }
 
+  if (ready_light_bake_pending) {
+    terrain_renderer.upload_light_bake(gpu.device, *ready_light_bake_pending);
+    ready_light_bake_pending.reset();
+  }
+
+  if (ready_column_colors_pending) {
+    terrain_renderer.upload_column_colors(gpu.device, *ready_column_colors_pending);
+    ready_column_colors_pending.reset();
+  }
+
   if (ready_mesh_pending) {
     terrain_renderer.upload_mesh(gpu.device, *ready_mesh_pending);
 
-    std::shared_ptr<TerrainLightBake> ready_light_bake;
-    {
-      std::lock_guard<std::mutex> lk(async_terrain.pending_mtx);
-      ready_light_bake = std::move(async_terrain.pending_light_bake);
-    }
-    if (ready_light_bake)
-      terrain_renderer.upload_light_bake(gpu.device, *ready_light_bake);
-
     if (ready_map_pending && !ready_map_pending->columns.empty()) {
-      auto *ts = ecs.get<TerrainState>();
-      if (ts) {
-        instanced_terrain.build_instances(ready_map_pending->columns, *ts);
-        instanced_terrain.upload(gpu.device);
-      }
+      instanced_terrain.build_instances(ready_map_pending->columns);
+      instanced_terrain.upload(gpu.device);
     }
 
     auto *map_data = ecs.get_mut<MapData>();
@@ -239,8 +244,9 @@ void TopoGame::on_pre_frame_game(GpuContext &gpu, flecs::world &ecs) {
     ready_map_pending.reset();
     ready_contours_pending.reset();
 
-    player_spawned = false;
-    {
+    // A full-resolution result refines the preview already on screen, so
+    // the player is placed once per generation rather than per upload.
+    if (!player_spawned) {
       const auto *md = ecs.get<MapData>();
       if (md && !md->columns.empty()) {
         const auto *worley = ecs.get<WorleyParams>();
@@ -357,6 +363,7 @@ void TopoGame::on_render_game(GpuContext &gpu, FrameContext &frame, flecs::world
     if (regen_cooldown <= 0.0f) {
     ts->need_regenerate = false;
     async_terrain.is_generating = true;
+    player_spawned = false;
     async_terrain.cancel_requested.store(false, std::memory_order_relaxed);
     regen_cooldown = REGEN_COOLDOWN_SEC;
 
@@ -383,43 +390,61 @@ void TopoGame::on_render_game(GpuContext &gpu, FrameContext &frame, flecs::world
         return async_terrain.cancel_requested.load(std::memory_order_relaxed);
       };
 
-      auto md = std::make_shared<MapData>();
-      md->allocate(Config::MAP_WIDTH, Config::MAP_HEIGHT);
-
-      compose_layers(*md, elev_snap, river_snap, worley_snap, comp_snap, &async_terrain.async_cache);
-      if (should_abort()) { async_terrain.is_generating = false; return; }
-
-      md->columns = generate_basalt_columns_v2(*md, Config::HEX_SIZE);
-      if (should_abort()) { async_terrain.is_generating = false; return; }
-
-      auto fill = generate_lava_and_void(*md, comp_snap.void_chance, worley_snap.seed);
-      if (should_abort()) { async_terrain.is_generating = false; return; }
-      md->lava_bodies = std::move(fill.lava_bodies);
-      md->void_bodies = std::move(fill.void_bodies);
+      // The coarse pass shares world units with the full one, so only the
+      // raster-space knobs (map_scale, region size, hex size) are rescaled.
+      auto make_inputs = [&](int downsample) {
+        TerrainStageInputs in;
+        in.width  = Config::MAP_WIDTH / downsample;
+        in.height = Config::MAP_HEIGHT / downsample;
+        in.pixels_per_unit = Config::HEX_SIZE / downsample;
+        in.elev   = elev_snap;
+        in.elev.map_scale *= downsample;
+        in.river  = river_snap;
+        in.worley = worley_snap;
+        in.comp   = comp_snap;
+        in.comp.min_region_size = std::max(1, comp_snap.min_region_size / (downsample * downsample));
+        in.terrain = ts_snap;
+        in.light   = lp_snap;
+        return in;
+      };
 
-      auto light_bake = std::make_shared<TerrainLightBake>(bake_terrain_lighting(*md, lp_snap));
-      if (should_abort()) { async_terrain.is_generating = false; return; }
+      // Runs the stale stages of one graph and publishes whatever differs
+      // from what is on screen.
+      auto run_pass = [&](TerrainStageGraph &graph, const TerrainStageInputs &in) -> bool {
+        auto tp = SDL_GetTicks();
+        TerrainStageOutputs out;
+        if (!graph.run(in, &async_terrain.async_cache, &task_system, should_abort, out))
+          return false;
 
-      auto cd = std::make_shared<ContourData>();
-      int n = Config::MAP_WIDTH * Config::MAP_HEIGHT;
-      cd->heightmap.resize(n);
-      std::copy(md->basalt_height.begin(), md->basalt_height.end(), cd->heightmap.begin());
-      float interval = 1.0f / comp_snap.terrace_levels;
-      extract_contours(cd->heightmap, Config::MAP_WIDTH, Config::MAP_HEIGHT,
-                       interval, cd->contour_lines, cd->band_map);
-      simplify_contours(cd->contour_lines, 0.5f);
-      if (should_abort()) { async_terrain.is_generating = false; return; }
+        std::lock_guard<std::mutex> lk(async_terrain.pending_mtx);
+        if (out.mesh != published_mesh) {
+          async_terrain.pending_mesh     = out.mesh;
+          async_terrain.pending_map      = std::move(out.map);
+          async_terrain.pending_contours = std::move(out.contours);
+          published_mesh = out.mesh;
+        }
+        if (out.light_bake != published_light_bake) {
+          async_terrain.pending_light_bake = out.light_bake;
+          published_light_bake = out.light_bake;
+        }
+        if (out.column_colors != published_column_colors) {
+          async_terrain.pending_column_colors = out.column_colors;
+          published_column_colors = out.column_colors;
+        }
 
-      auto mesh = std::make_shared<TerrainMesh>(build_terrain_mesh(ts_snap, *md, *cd));
-      if (should_abort()) { async_terrain.is_generating = false; return; }
+        SDL_Log("Async regen: %dx%d pass in %llu ms", in.width, in.height,
+                (unsigned long long)(SDL_GetTicks() - tp));
+        return true;
+      };
 
-      {
-        std::lock_guard<std::mutex> lk(async_terrain.pending_mtx);
-        async_terrain.pending_mesh       = std::move(mesh);
-        async_terrain.pending_map        = std::move(md);
-        async_terrain.pending_contours   = std::move(cd);
-        async_terrain.pending_light_bake = std::move(light_bake);
-      }
+      // Only a change that reaches the noise layers is slow enough to be
+      // worth a coarse preview first.
+      TerrainStageInputs full_in = make_inputs(1);
+      bool ok = true;
+      if (full_stages.stale(full_in, TerrainStageGraph::COMPOSE))
+        ok = run_pass(preview_stages, make_inputs(Config::PREVIEW_DOWNSAMPLE));
+      if (ok && !should_abort())
+        run_pass(full_stages, full_in);
       async_terrain.is_generating = false;
 
       SDL_Log("Async regen: done in %llu ms", (unsigned long long)(SDL_GetTicks() - t0));
@@ -427,11 +452,13 @@ void TopoGame::on_render_game(GpuContext &gpu, FrameContext &frame, flecs::world
     }
   }
 
-  if (ts && !async_terrain.is_generating && !ready_mesh_pending) {
+  if (ts && !ready_mesh_pending && !ready_light_bake_pending && !ready_column_colors_pending) {
     std::lock_guard<std::mutex> lk(async_terrain.pending_mtx);
-    ready_mesh_pending     = std::move(async_terrain.pending_mesh);
-    ready_map_pending      = std::move(async_terrain.pending_map);
-    ready_contours_pending = std::move(async_terrain.pending_contours);
+    ready_mesh_pending          = std::move(async_terrain.pending_mesh);
+    ready_map_pending           = std::move(async_terrain.pending_map);
+    ready_contours_pending      = std::move(async_terrain.pending_contours);
+    ready_light_bake_pending    = std::move(async_terrain.pending_light_bake);
+    ready_column_colors_pending = std::move(async_terrain.pending_column_colors);
   }
 
   float time = SDL_GetTicks() / 1000.0f;
@@ -444,11 +471,11 @@ void TopoGame::on_render_game(GpuContext &gpu, FrameContext &frame, flecs::world
 
   point_lights.clear();
   if (map_data) {
-    const float inv = 1.0f / Config::HEX_SIZE;
+    const float inv = 1.0f / map_data->pixels_per_unit;
     for (const auto &lava : map_data->lava_bodies) {
       float cx = (lava.min_x + lava.max_x) * 0.5f * inv;
       float cy = (lava.min_y + lava.max_y) * 0.5f * inv;
-      float area_units = (float)lava.pixels.size() / (Config::HEX_SIZE * Config::HEX_SIZE);
+      float area_units = (float)lava.mask.area * inv * inv;
       float radius = std::clamp(std::sqrt(area_units) * 1.5f, 6.0f, 16.0f);
       GpuPointLight pl;
       pl.pos_x     = cx;
@@ -527,6 +554,7 @@ void TopoGame::on_render_game(GpuContext &gpu, FrameContext &frame, flecs::world
                                 terrain_renderer.get_global_index_ssbo(),
                                 terrain_renderer.light_texture(),
                                 terrain_renderer.light_sampler(),
+                                terrain_renderer.light_height_texture(),
                                 terrain_renderer.fluence_texture(),
                                 terrain_renderer.fluence_sampler());
           SDL_EndGPURenderPass(actor_pass);
@@ -622,6 +650,17 @@ void TopoGame::render_ui(flecs::world &ecs, bool game_window_open) {
   ts->need_regenerate |= ImGui::IsItemDeactivatedAfterEdit();
   ImGui::SliderInt(  "Warp Octaves", &worley->warp_octaves,   1, 6);
   ts->need_regenerate |= ImGui::IsItemDeactivatedAfterEdit();
+  ImGui::SliderInt(  "Warp Lattice", &worley->warp_lattice_step, 1, 16);
+  ts->need_regenerate |= ImGui::IsItemDeactivatedAfterEdit();
+  if (ImGui::Button("Measure Warp Error")) {
+    WorleyParams wp = *worley;
+    wp.map_scale = ts->map_scale;
+    warp_error_px = measure_worley_warp_error(Config::MAP_WIDTH, Config::MAP_HEIGHT, wp);
+  }
+  if (warp_error_px >= 0.0f) {
+    ImGui::SameLine();
+    ImGui::Text("max %.3f px", warp_error_px);
+  }
 
   ImGui::Separator();
   ImGui::Text("Composition");
@@ -698,16 +737,15 @@ void TopoGame::render_ui(flecs::world &ecs, bool game_window_open) {
     ImGui::SliderFloat("Sky Ambient",     &sky_intensity,  0.0f, 2.0f);
     ImGui::SliderFloat("Sun Ambient",     &sun_ambient,    0.0f, 1.0f);
     ImGui::SliderFloat("Sun Elevation",   &light_params.sun_elevation_deg, 20.0f, 80.0f, "%.0f deg");
+    ts->need_regenerate |= ImGui::IsItemDeactivatedAfterEdit();
     ImGui::SliderFloat("Shadow Softness", &light_params.penumbra_deg,       0.0f, 15.0f, "%.1f deg");
-    ImGui::BeginDisabled(async_terrain.is_generating);
-    if (ImGui::Button("Rebake Shadows", {-1, 0})) {
-      const auto *md_live = ecs.get<MapData>();
-      if (md_live && !md_live->basalt_height.empty()) {
-        terrain_renderer.upload_light_bake(
-            gpu_ctx.device, bake_terrain_lighting(*md_live, light_params));
-      }
+    ts->need_regenerate |= ImGui::IsItemDeactivatedAfterEdit();
+    const char *bake_res_names[] = { "Full", "Half", "Quarter" };
+    int bake_res = light_params.resolution_divisor >= 4 ? 2 : light_params.resolution_divisor - 1;
+    if (ImGui::Combo("Light Bake Resolution", &bake_res, bake_res_names, IM_ARRAYSIZE(bake_res_names))) {
+      light_params.resolution_divisor = 1 << bake_res;
+      ts->need_regenerate = true;
     }
-    ImGui::EndDisabled();
 
     ImGui::Checkbox("Lava GI (Radiance Cascades)", &rc_enabled);
     ImGui::SliderFloat("Lava GI Intensity", &rc_intensity,     0.0f, 4.0f);
@@ -727,8 +765,17 @@ void TopoGame::render_ui(flecs::world &ecs, bool game_window_open) {
 
   ImGui::Separator();
   ImGui::Text("Stats");
-  ImGui::Text("Contour Lines: %zu", contours ? contours->contour_lines.size() : 0u);
+  ImGui::Text("Contour Strips: %zu (%zu points)",
+              contours ? contours->contour_strips.strip_count() : 0u,
+              contours ? contours->contour_strips.points.size() : 0u);
   ImGui::Text("Resolution: %dx%d", Config::MAP_WIDTH, Config::MAP_HEIGHT);
+  {
+    NoiseCache::Stats cs = async_terrain.async_cache.stats();
+    ImGui::Text("Noise Cache: %zu entries, %.1f MB", cs.entries, cs.bytes / (1024.0 * 1024.0));
+    ImGui::Text("  %llu hits, %llu disk hits, %llu misses, %llu evictions",
+                (unsigned long long)cs.hits, (unsigned long long)cs.disk_hits,
+                (unsigned long long)cs.misses, (unsigned long long)cs.evictions);
+  }
   ImGui::Text("Camera: (%.1f, %.1f) zoom %.2fx", camera.world_x, camera.world_y, camera.zoom);
 
   ImGui::Separator();
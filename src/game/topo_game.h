@@ -7,6 +7,7 @@
 #include "terrain/map_data.h"
 #include "terrain/terrain_renderer.h"
 #include "terrain/terrain_mesh.h"
+#include "terrain/terrain_stages.h"
 #include "terrain/instanced_terrain.h"
 #include "core/task_system.h"
 #include "input/input.h"
@@ -52,11 +53,21 @@ private:
   void render_ui(flecs::world &ecs, bool game_window_open);
   int save_status_timer = 0;
 
-  std::shared_ptr<TerrainMesh> ready_mesh_pending;
+  std::shared_ptr<const TerrainMesh> ready_mesh_pending;
   std::shared_ptr<MapData>     ready_map_pending;
   std::shared_ptr<ContourData> ready_contours_pending;
+  std::shared_ptr<const TerrainLightBake> ready_light_bake_pending;
+  std::shared_ptr<const std::vector<GpuColumnColor>> ready_column_colors_pending;
+
+  // Owned by the async regen task; at most one runs at a time.
+  TerrainStageGraph preview_stages;
+  TerrainStageGraph full_stages;
+  std::shared_ptr<const TerrainMesh>      published_mesh;
+  std::shared_ptr<const TerrainLightBake> published_light_bake;
+  std::shared_ptr<const std::vector<GpuColumnColor>> published_column_colors;
 
   float regen_cooldown = 0.0f;
+  float warp_error_px  = -1.0f;
 
   TerrainLightParams light_params;
   float light_exposure = 1.6f;
@@ -8,17 +8,20 @@ struct PointLight {
 
 layout(set = 2, binding = 0) uniform sampler2D terrain_light_tex;
 
-layout(set = 2, binding = 1) uniform sampler2D rc_fluence;
+// R16 surface height the bake was taken at, in units of TL_HEIGHT_RANGE.
+layout(set = 2, binding = 1) uniform sampler2D terrain_height_tex;
 
-layout(set = 2, binding = 2) readonly buffer LightBuffer {
+layout(set = 2, binding = 2) uniform sampler2D rc_fluence;
+
+layout(set = 2, binding = 3) readonly buffer LightBuffer {
     PointLight point_lights[];
 };
 
-layout(set = 2, binding = 3) readonly buffer LightGridBuffer {
+layout(set = 2, binding = 4) readonly buffer LightGridBuffer {
     uvec2 light_grid[];
 };
 
-layout(set = 2, binding = 4) readonly buffer IndexBuffer {
+layout(set = 2, binding = 5) readonly buffer IndexBuffer {
     uint global_light_indices[];
 };
 
@@ -26,7 +29,8 @@ const float TL_HEIGHT_RANGE = 1.25;
 const float TL_HEIGHT_TOL   = 0.02;
 
 vec2 sample_terrain_light(vec2 world_xy, float world_z) {
-    vec2 ts = vec2(textureSize(terrain_light_tex, 0));
+    vec2  ts = vec2(textureSize(terrain_light_tex, 0));
+    ivec2 hs = textureSize(terrain_height_tex, 0);
     vec2 p  = world_xy * INV_MAP_UNITS * ts;
     vec2 b  = floor(p);
     vec2 f  = p - b;
@@ -36,12 +40,13 @@ vec2 sample_terrain_light(vec2 world_xy, float world_z) {
     float wsum  = 0.0;
     for (int i = 0; i < 4; ++i) {
         ivec2 o = ivec2(i & 1, i >> 1);
-        vec4  t = texelFetch(terrain_light_tex,
-                             clamp(ivec2(b) + o, ivec2(0), ivec2(ts) - 1), 0);
+        ivec2 c = clamp(ivec2(b) + o, ivec2(0), ivec2(ts) - 1);
+        vec2  t = texelFetch(terrain_light_tex, c, 0).rg;
+        float h = texelFetch(terrain_height_tex, min(c, hs - 1), 0).r;
         float bw = (o.x == 0 ? 1.0 - f.x : f.x) * (o.y == 0 ? 1.0 - f.y : f.y);
-        float hw = exp(-abs(t.b * TL_HEIGHT_RANGE - world_z) / TL_HEIGHT_TOL);
-        acc   += t.rg * (bw * hw);
-        bilin += t.rg * bw;
+        float hw = exp(-abs(h * TL_HEIGHT_RANGE - world_z) / TL_HEIGHT_TOL);
+        acc   += t * (bw * hw);
+        bilin += t * bw;
         wsum  += bw * hw;
     }
     return wsum > 1e-4 ? acc / wsum : bilin;
@@ -0,0 +1,198 @@
+#include "bench_harness.h"
+#include "terrain/basalt.h"
+#include "terrain/contour.h"
+#include "terrain/lava.h"
+#include "terrain/map_data.h"
+#include "terrain/noise_composer.h"
+#include "terrain/noise_layers.h"
+#include "terrain/terrain_lighting.h"
+#include "core/task_system.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+// Workers for the "parallel" variants, sized as the game sizes its pool.
+static TaskSystem &bench_tasks() {
+  struct Pool {
+    TaskSystem tasks;
+    Pool() { tasks.init((int)std::max(1u, std::thread::hardware_concurrency())); }
+    ~Pool() { tasks.shutdown(); }
+  };
+  static Pool pool;
+  return pool.tasks;
+}
+
+// Terraced elevation at the game's default feature scale per pixel.
+static std::vector<float> terraced_elevation(int size, int levels) {
+  std::vector<float> h;
+  ElevationParams elev;
+  elev.seed = 1337;
+  generate_elevation_layer(h, size, size, elev, &bench_tasks());
+  for (float &v : h)
+    v = std::floor(v * levels) / levels;
+  return h;
+}
+
+DELVE_BENCH(cleanup_small_regions) {
+  CompositionParams comp;
+  for (int size : {1024, 4096, 8192}) {
+    const std::vector<float> input = terraced_elevation(size, comp.terrace_levels);
+    std::vector<float> h;
+    auto reset = [&] { h = input; };
+    int reps = size > 4096 ? 3 : 5;
+
+    double serial = bench_median_ms(reps, reset, [&] {
+      cleanup_small_regions(h, size, size, comp.terrace_levels, comp.min_region_size,
+                            comp.keep_edge_regions);
+    });
+    bench_report("cleanup_small_regions", "serial", size, serial);
+
+    double parallel = bench_median_ms(reps, reset, [&] {
+      cleanup_small_regions(h, size, size, comp.terrace_levels, comp.min_region_size,
+                            comp.keep_edge_regions, &bench_tasks());
+    });
+    bench_report("cleanup_small_regions", "parallel", size, parallel);
+  }
+}
+
+// Column placement including the hex rasterization into terrain_map; small
+// hexes mean many more, smaller hexes per map.
+DELVE_BENCH(basalt_columns) {
+  const int size = 2048;
+  MapData composed;
+  composed.allocate(size, size);
+  ElevationParams elev;
+  elev.seed = 1337;
+  RiverParams river;
+  WorleyParams worley;
+  CompositionParams comp;
+  compose_layers(composed, elev, river, worley, comp, nullptr, &bench_tasks());
+
+  for (float hex_size : {2.0f, 4.0f, 8.0f}) {
+    MapData md;
+    char variant[32];
+    double serial = bench_median_ms(5, [&] { md = composed; }, [&] {
+      md.columns = generate_basalt_columns_v2(md, hex_size);
+    });
+    snprintf(variant, sizeof(variant), "hex%g_serial", hex_size);
+    bench_report("basalt_columns", variant, size, serial);
+
+    double parallel = bench_median_ms(5, [&] { md = composed; }, [&] {
+      md.columns = generate_basalt_columns_v2(md, hex_size, {}, &bench_tasks());
+    });
+    snprintf(variant, sizeof(variant), "hex%g_parallel", hex_size);
+    bench_report("basalt_columns", variant, size, parallel);
+  }
+}
+
+// Lava/void body extraction and lava meshing on a map with placed columns.
+DELVE_BENCH(lava_and_void) {
+  for (int size : {1024, 2048, 4096}) {
+    MapData placed;
+    placed.allocate(size, size);
+    ElevationParams elev;
+    elev.seed = 1337;
+    CompositionParams comp;
+    compose_layers(placed, elev, RiverParams{}, WorleyParams{}, comp, nullptr, &bench_tasks());
+    placed.columns = generate_basalt_columns_v2(placed, Config::HEX_SIZE, {}, &bench_tasks());
+
+    MapData md;
+    auto reset = [&] { md = placed; };
+    double serial = bench_median_ms(5, reset, [&] {
+      generate_lava_and_void(md, comp.void_chance, 1337);
+    });
+    bench_report("lava_and_void", "serial", size, serial);
+
+    double parallel = bench_median_ms(5, reset, [&] {
+      generate_lava_and_void(md, comp.void_chance, 1337, &bench_tasks());
+    });
+    bench_report("lava_and_void", "parallel", size, parallel);
+  }
+}
+
+DELVE_BENCH(extract_contours) {
+  CompositionParams comp;
+  for (int size : {2048, 4096}) {
+    MapData md;
+    md.allocate(size, size);
+    ElevationParams elev;
+    elev.seed = 1337;
+    compose_layers(md, elev, RiverParams{}, WorleyParams{}, comp, nullptr, &bench_tasks());
+
+    std::vector<Line> lines;
+    std::vector<int> bands;
+    float interval = 1.0f / comp.terrace_levels;
+    double serial = bench_median_ms(5, nullptr, [&] {
+      extract_contours(*md.basalt_height, size, size, interval, lines, bands);
+    });
+    bench_report("extract_contours", "serial", size, serial);
+
+    double parallel = bench_median_ms(5, nullptr, [&] {
+      extract_contours(*md.basalt_height, size, size, interval, lines, bands, &bench_tasks());
+    });
+    bench_report("extract_contours", "parallel", size, parallel);
+  }
+}
+
+DELVE_BENCH(stitch_contours) {
+  CompositionParams comp;
+  for (int size : {2048, 4096}) {
+    MapData md;
+    md.allocate(size, size);
+    ElevationParams elev;
+    elev.seed = 1337;
+    compose_layers(md, elev, RiverParams{}, WorleyParams{}, comp, nullptr, &bench_tasks());
+
+    std::vector<Line> lines;
+    std::vector<int> bands;
+    extract_contours(*md.basalt_height, size, size, 1.0f / comp.terrace_levels, lines, bands);
+    float tolerance = Config::CONTOUR_TOLERANCE * Config::HEX_SIZE;
+    double serial = bench_median_ms(5, nullptr, [&] { stitch_contours(lines, tolerance); });
+    bench_report("stitch_contours", "serial", size, serial);
+
+    double parallel = bench_median_ms(5, nullptr, [&] {
+      stitch_contours(lines, tolerance, &bench_tasks());
+    });
+    bench_report("stitch_contours", "parallel", size, parallel);
+  }
+}
+
+DELVE_BENCH(terrain_light_bake) {
+  CompositionParams comp;
+  for (int size : {1024, 2048}) {
+    MapData md;
+    md.allocate(size, size);
+    ElevationParams elev;
+    elev.seed = 1337;
+    compose_layers(md, elev, RiverParams{}, WorleyParams{}, comp, nullptr, &bench_tasks());
+    md.columns = generate_basalt_columns_v2(md, md.pixels_per_unit, {}, &bench_tasks());
+
+    TerrainLightParams params;
+    params.pixels_per_unit = md.pixels_per_unit;
+    double serial = bench_median_ms(3, nullptr, [&] { bake_terrain_lighting(md, params); });
+    bench_report("terrain_light_bake", "serial", size, serial);
+
+    double parallel = bench_median_ms(3, nullptr, [&] {
+      bake_terrain_lighting(md, params, &bench_tasks());
+    });
+    bench_report("terrain_light_bake", "parallel", size, parallel);
+
+    TerrainHorizons horizons = sweep_terrain_horizons(md, params, &bench_tasks());
+    double reshade = bench_median_ms(5, nullptr, [&] {
+      params.sun_elevation_deg += 1.0f;
+      shade_terrain_light(horizons, params, &bench_tasks());
+    });
+    bench_report("terrain_light_bake", "reshade", size, reshade);
+
+    for (int div : {2, 4}) {
+      TerrainLightParams coarse = params;
+      coarse.resolution_divisor = div;
+      double ms = bench_median_ms(3, nullptr, [&] {
+        bake_terrain_lighting(md, coarse, &bench_tasks());
+      });
+      bench_report("terrain_light_bake", div == 2 ? "half" : "quarter", size, ms);
+    }
+  }
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+struct BenchCase {
+  std::string name;
+  std::function<void()> fn;
+};
+
+class BenchRegistry {
+public:
+  static std::vector<BenchCase> &cases() {
+    static std::vector<BenchCase> c;
+    return c;
+  }
+
+  static int add(const char *name, std::function<void()> fn) {
+    cases().push_back({name, std::move(fn)});
+    return 0;
+  }
+
+  // Runs the benchmarks whose name contains `filter` (all when empty).
+  static int run_all(const std::string &filter) {
+    printf("{\"results\":[\n");
+    for (auto &bc : cases())
+      if (filter.empty() || bc.name.find(filter) != std::string::npos)
+        bc.fn();
+    printf("  {}\n]}\n");
+    return 0;
+  }
+};
+
+// Median wall time of `reps` calls to fn, in milliseconds. `setup`, if
+// set, runs before each call and is not timed.
+inline double bench_median_ms(int reps, const std::function<void()> &setup,
+                              const std::function<void()> &fn) {
+  std::vector<double> ms;
+  for (int i = 0; i < reps; ++i) {
+    if (setup)
+      setup();
+    auto t0 = std::chrono::steady_clock::now();
+    fn();
+    auto t1 = std::chrono::steady_clock::now();
+    ms.push_back(std::chrono::duration<double, std::milli>(t1 - t0).count());
+  }
+  std::sort(ms.begin(), ms.end());
+  return ms[ms.size() / 2];
+}
+
+inline void bench_report(const char *name, const char *variant, int size, double ms) {
+  printf("  {\"name\":\"%s\",\"variant\":\"%s\",\"size\":%d,\"ms\":%.2f},\n",
+         name, variant, size, ms);
+  fflush(stdout);
+}
+
+#define DELVE_BENCH(name)                                                      \
+  static void bench_fn_##name();                                               \
+  static int bench_reg_##name = BenchRegistry::add(#name, bench_fn_##name);    \
+  static void bench_fn_##name()
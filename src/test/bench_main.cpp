@@ -0,0 +1,5 @@
+#include "bench_harness.h"
+
+int main(int argc, char **argv) {
+  return BenchRegistry::run_all(argc > 1 ? argv[1] : "");
+}
@@ -59,14 +59,15 @@ inline float hex_roundtrip_accuracy(float hex_size, int range) {
   return total > 0 ? (float)accurate / total : 0;
 }
 
-inline float vertex_color_validity(const TerrainMesh &m) {
+inline float vertex_color_validity(const TerrainMesh &m,
+                                   const std::vector<GpuColumnColor> &colors) {
   size_t total = 0, valid = 0;
   for (auto &layer : m.basalt_layers) {
     for (auto &v : layer.vertices) {
       ++total;
-      if (v.color_r >= 0 && v.color_r <= 1 &&
-          v.color_g >= 0 && v.color_g <= 1 &&
-          v.color_b >= 0 && v.color_b <= 1)
+      if (v.column >= colors.size()) continue;
+      const GpuColumnColor &c = colors[v.column];
+      if (c.r >= 0 && c.r <= 1 && c.g >= 0 && c.g <= 1 && c.b >= 0 && c.b <= 1)
         ++valid;
     }
   }
@@ -1,5 +1,6 @@
 #pragma once
 #include "terrain/map_data.h"
+#include "terrain/terrain_lighting.h"
 #include <algorithm>
 #include <cmath>
 #include <numeric>
@@ -42,12 +43,9 @@ inline int plateau_count(std::span<const int> band_map, int width, int height) {
   return mx;
 }
 
-inline ElevationStats hex_column_height_stats(const std::vector<HexColumn> &cols) {
+inline ElevationStats hex_column_height_stats(const HexColumnsSoA &cols) {
   if (cols.empty()) return {0, 0, 0, 0};
-  std::vector<float> heights;
-  heights.reserve(cols.size());
-  for (auto &c : cols) heights.push_back(c.height);
-  return elevation_stats(heights);
+  return elevation_stats(cols.height);
 }
 
 inline int lava_body_count(const MapData &md) { return (int)md.lava_bodies.size(); }
@@ -72,3 +70,65 @@ inline float basalt_coverage_ratio(const MapData &md) {
   for (auto v : md.terrain_map) if (v == TERRAIN_BASALT) ++count;
   return (float)count / md.terrain_map.size();
 }
+
+// Error of a light bake against a reference of the same size, per channel
+// in [0, 1] units: RMS and worst pixel for sun (R) and sky (G).
+struct LightBakeError {
+  float sun_rmse, sun_max, sky_rmse, sky_max;
+};
+
+inline LightBakeError light_bake_error(const TerrainLightBake &ref,
+                                       const TerrainLightBake &bake) {
+  size_t n = std::min(ref.rg.size(), bake.rg.size()) / 2;
+  if (n == 0) return {0, 0, 0, 0};
+  double sun2 = 0, sky2 = 0;
+  float sun_max = 0, sky_max = 0;
+  for (size_t i = 0; i < n; ++i) {
+    float ds = (ref.rg[i * 2 + 0] - bake.rg[i * 2 + 0]) / 255.0f;
+    float dk = (ref.rg[i * 2 + 1] - bake.rg[i * 2 + 1]) / 255.0f;
+    sun2 += ds * ds;
+    sky2 += dk * dk;
+    sun_max = std::max(sun_max, std::abs(ds));
+    sky_max = std::max(sky_max, std::abs(dk));
+  }
+  return {(float)std::sqrt(sun2 / n), sun_max, (float)std::sqrt(sky2 / n), sky_max};
+}
+
+// Sun error of a bake whose shadow edges may sit up to `reach` pixels away
+// from the reference's. A pixel is on an edge when the reference has a lit
+// and a shadowed pixel (sun above / below one half) within `reach` of it.
+// Misplaced pixels have a sun term off by more than half; the RMS error is
+// over pixels away from every edge.
+struct LightBakeEdgeError {
+  size_t misplaced, misplaced_off_edge;
+  float off_edge_sun_rmse;
+};
+
+inline LightBakeEdgeError light_bake_edge_error(const TerrainLightBake &ref,
+                                                const TerrainLightBake &bake, int reach) {
+  const int w = ref.width, h = ref.height;
+  auto lit = [&](int x, int y) { return ref.rg[((size_t)y * w + x) * 2] >= 128; };
+  LightBakeEdgeError e{0, 0, 0.0f};
+  double sun2 = 0;
+  size_t off_edge = 0;
+  for (int y = 0; y < h; ++y) {
+    for (int x = 0; x < w; ++x) {
+      bool edge = false;
+      for (int ny = std::max(0, y - reach); ny <= std::min(h - 1, y + reach) && !edge; ++ny)
+        for (int nx = std::max(0, x - reach); nx <= std::min(w - 1, x + reach) && !edge; ++nx)
+          edge = lit(nx, ny) != lit(x, y);
+      size_t i = ((size_t)y * w + x) * 2;
+      float ds = (ref.rg[i] - bake.rg[i]) / 255.0f;
+      if (std::abs(ds) > 0.5f) {
+        e.misplaced++;
+        if (!edge) e.misplaced_off_edge++;
+      }
+      if (!edge) {
+        sun2 += ds * ds;
+        off_edge++;
+      }
+    }
+  }
+  if (off_edge) e.off_edge_sun_rmse = (float)std::sqrt(sun2 / off_edge);
+  return e;
+}
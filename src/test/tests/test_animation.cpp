@@ -157,10 +157,11 @@ static MapData make_slope_map(int w, int h, float slope) {
   MapData map;
   map.width = w;
   map.height = h;
-  map.basalt_height.resize(w * h);
+  std::vector<float> heights(w * h);
   for (int y = 0; y < h; ++y)
     for (int x = 0; x < w; ++x)
-      map.basalt_height[y * w + x] = slope * (float)x;
+      heights[y * w + x] = slope * (float)x;
+  map.basalt_height = std::make_shared<const std::vector<float>>(std::move(heights));
   return map;
 }
 
@@ -168,7 +169,7 @@ static MapData make_flat_map(int w, int h, float height) {
   MapData map;
   map.width = w;
   map.height = h;
-  map.basalt_height.resize(w * h, height);
+  map.basalt_height = std::make_shared<const std::vector<float>>(w * h, height);
   return map;
 }
 
@@ -1,6 +1,7 @@
 #include "test_harness.h"
 #include "core/task_system.h"
 #include <atomic>
+#include <vector>
 #include <thread>
 #include <chrono>
 
@@ -58,3 +59,31 @@ DELVE_TEST(async_cancel_pattern_no_crash) {
     EXPECT_LT(completed.load(), 50);
     return true;
 }
+
+DELVE_TEST(task_system_parallel_for_covers_every_index_once) {
+    TaskSystem ts;
+    ts.init(4);
+    std::vector<std::atomic<int>> hits(1000);
+    ts.parallel_for((int)hits.size(), [&hits](int i) { hits[i].fetch_add(1); });
+    ts.shutdown();
+    for (auto &h : hits)
+        EXPECT_EQ(h.load(), 1);
+    return true;
+}
+
+DELVE_TEST(task_system_parallel_for_nested_in_task) {
+    TaskSystem ts;
+    ts.init(2);
+    std::atomic<int> sum{0};
+    std::atomic<bool> finished{false};
+    ts.enqueue([&] {
+        ts.parallel_for(64, [&sum](int i) { sum.fetch_add(i); });
+        finished.store(true);
+    });
+    for (int i = 0; i < 2000 && !finished.load(); ++i)
+        std::this_thread::sleep_for(std::chrono::microseconds(500));
+    ts.shutdown();
+    EXPECT_TRUE(finished.load());
+    EXPECT_EQ(sum.load(), 64 * 63 / 2);
+    return true;
+}
@@ -0,0 +1,171 @@
+#include "test_harness.h"
+#include "terrain/components.h"
+#include "terrain/map_util.h"
+#include "core/task_system.h"
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+// Plain flood fill, seeding in raster order, as the reference labelling.
+static std::vector<int32_t> flood_labels(const std::vector<int32_t> &cls, int w, int h,
+                                         Connectivity conn) {
+  std::vector<std::pair<int, int>> dirs = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+  if (conn == Connectivity::Eight)
+    dirs.insert(dirs.end(), {{1, 1}, {-1, -1}, {1, -1}, {-1, 1}});
+  if (conn == Connectivity::HexAxial)
+    dirs.insert(dirs.end(), {{1, -1}, {-1, 1}});
+
+  std::vector<int32_t> labels(w * h, -1);
+  int32_t next = 0;
+  std::vector<int> stack;
+  for (int start = 0; start < w * h; ++start) {
+    if (cls[start] < 0 || labels[start] >= 0) continue;
+    labels[start] = next;
+    stack.assign(1, start);
+    while (!stack.empty()) {
+      int idx = stack.back();
+      stack.pop_back();
+      int x = idx % w, y = idx / w;
+      for (auto [dx, dy] : dirs) {
+        int nx = x + dx, ny = y + dy;
+        if (nx < 0 || ny < 0 || nx >= w || ny >= h) continue;
+        int ni = ny * w + nx;
+        if (labels[ni] < 0 && cls[ni] == cls[start]) {
+          labels[ni] = next;
+          stack.push_back(ni);
+        }
+      }
+    }
+    ++next;
+  }
+  return labels;
+}
+
+static std::vector<int32_t> random_classes(int w, int h, int class_count, uint32_t seed) {
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<int> d(-1, class_count - 1);
+  std::vector<int32_t> cls(w * h);
+  for (auto &c : cls) c = d(rng);
+  return cls;
+}
+
+DELVE_TEST(components_match_flood_fill) {
+  const int W = 97, H = 150;  // spans several row bands
+  auto cls = random_classes(W, H, 3, 7);
+  for (Connectivity conn : {Connectivity::Four, Connectivity::Eight, Connectivity::HexAxial}) {
+    std::vector<int32_t> ref = flood_labels(cls, W, H, conn);
+    ComponentLabels serial = label_components(cls, W, H, conn);
+    TaskSystem ts;
+    ts.init(3);
+    ComponentLabels banded = label_components(cls, W, H, conn, &ts);
+    ts.shutdown();
+    EXPECT_TRUE(serial.labels == ref);
+    EXPECT_TRUE(banded.labels == ref);
+    EXPECT_EQ(serial.count(), banded.count());
+  }
+  return true;
+}
+
+DELVE_TEST(components_report_area_and_bounds) {
+  // Two '1' regions joined only diagonally, plus background.
+  const int W = 6, H = 4;
+  std::vector<int32_t> cls = {
+      1, 1, 0, 0, 0, -1,
+      1, 1, 0, 0, 0, 0,
+      0, 0, 1, 1, 1, 0,
+      0, 0, 0, 0, 0, 0,
+  };
+  ComponentLabels four = label_components(cls, W, H);
+  EXPECT_EQ(four.count(), 3);
+  EXPECT_EQ(four.labels[5], -1);
+
+  const ComponentStats &a = four.components[0];
+  EXPECT_EQ(a.cls, 1);
+  EXPECT_EQ(a.area, 4);
+  EXPECT_EQ(a.first_pixel, 0);
+  EXPECT_EQ(a.max_x, 1);
+  EXPECT_EQ(a.max_y, 1);
+  EXPECT_TRUE(a.touches_border(W, H));
+
+  const ComponentStats &zeros = four.components[1];
+  EXPECT_EQ(zeros.cls, 0);
+  EXPECT_EQ(zeros.area, 16);
+  EXPECT_EQ(zeros.first_pixel, 2);
+
+  const ComponentStats &b = four.components[2];
+  EXPECT_EQ(b.area, 3);
+  EXPECT_EQ(b.min_x, 2);
+  EXPECT_EQ(b.max_x, 4);
+  EXPECT_EQ(b.min_y, 2);
+  EXPECT_FALSE(b.touches_border(W, H));
+
+  ComponentLabels eight = label_components(cls, W, H, Connectivity::Eight);
+  EXPECT_EQ(eight.count(), 2);
+  EXPECT_EQ(eight.components[0].area, 7);
+  return true;
+}
+
+DELVE_TEST(component_runs_match_label_image) {
+  const int W = 131, H = 200;
+  auto cls = random_classes(W, H, 2, 11);
+  ComponentLabels labels = label_components(cls, W, H, Connectivity::Eight);
+  TaskSystem ts;
+  ts.init(3);
+  ComponentRuns runs = label_component_runs(
+      W, H, [&](int y, int32_t *row) { std::copy_n(cls.data() + y * W, W, row); },
+      Connectivity::Eight, &ts);
+  ts.shutdown();
+
+  EXPECT_EQ(runs.count(), labels.count());
+  std::vector<int32_t> painted(W * H, -1);
+  for (int y = 0; y < H; ++y)
+    for (int32_t i = runs.row_begin[y]; i < runs.row_begin[y + 1]; ++i) {
+      const ComponentRun &r = runs.runs[i];
+      EXPECT_EQ(r.y, y);
+      for (int x = r.x0; x <= r.x1; ++x)
+        painted[y * W + x] = r.label;
+    }
+  EXPECT_TRUE(painted == labels.labels);
+  return true;
+}
+
+// The spawn draw as it was before find_spawn_column shared the labeller:
+// breadth-first from each unvisited column, keeping the first largest.
+static size_t bfs_spawn_index(const HexColumnsSoA &cols, uint32_t seed) {
+  HexGrid grid(cols);
+  std::vector<bool> visited(cols.size(), false);
+  std::vector<size_t> best, component;
+  for (size_t start = 0; start < cols.size(); ++start) {
+    if (visited[start]) continue;
+    visited[start] = true;
+    component.assign(1, start);
+    for (size_t qi = 0; qi < component.size(); ++qi)
+      for (int d = 0; d < 6; ++d) {
+        int32_t ni = grid.neighbor(cols.q[component[qi]], cols.r[component[qi]], d);
+        if (ni < 0 || visited[ni]) continue;
+        visited[ni] = true;
+        component.push_back((size_t)ni);
+      }
+    if (component.size() > best.size()) best = component;
+  }
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<size_t> dist(0, best.size() - 1);
+  return best[dist(rng)];
+}
+
+DELVE_TEST(spawn_column_draw_matches_bfs_order) {
+  const int W = 40, H = 30;
+  auto cls = random_classes(W, H, 1, 5);
+  MapData map;
+  for (int r = 0; r < H; ++r)
+    for (int q = 0; q < W; ++q)
+      if (cls[r * W + q] == 0) map.columns.push_back(q - 7, r - 3, 1.f, 0.f);
+  for (uint32_t seed = 0; seed < 64; ++seed) {
+    HexColumn got = find_spawn_column(map, seed);
+    size_t want = bfs_spawn_index(map.columns, seed);
+    EXPECT_EQ(got.q, map.columns.q[want]);
+    EXPECT_EQ(got.r, map.columns.r[want]);
+  }
+  return true;
+}
@@ -227,7 +227,7 @@ DELVE_TEST(spawn_height_sample_roundtrip) {
     float sampled_h = sample_world_height(md, wx, wy);
     int ix = std::max(0, std::min((int)(px), W - 1));
     int iy = std::max(0, std::min((int)(py), H - 1));
-    float direct_h = md.basalt_height[iy * W + ix];
+    float direct_h = (*md.basalt_height)[iy * W + ix];
     EXPECT_NEAR(sampled_h, direct_h, 0.5f);
     return true;
 }
@@ -1,8 +1,10 @@
 #include "test_harness.h"
 #include "terrain/hex.h"
 #include "core/types.h"
+#include <algorithm>
 #include <cmath>
 #include <set>
+#include <vector>
 
 static constexpr float HEX = 8.0f;
 
@@ -30,27 +32,27 @@ DELVE_TEST(hex_to_pixel_origin) {
 }
 
 DELVE_TEST(hex_visible_edge_for_subtle_height_drop) {
-  std::vector<HexColumn> cols(2);
-  cols[0].q = 0; cols[0].r = 0; cols[0].height = 0.5f;
-  cols[1].q = 1; cols[1].r = 0; cols[1].height = 0.495f;
+  HexColumnsSoA cols;
+  cols.push_back(0, 0, 0.5f, 0.5f);
+  cols.push_back(1, 0, 0.495f, 0.495f);
 
   compute_visible_edges(cols);
 
-  EXPECT_TRUE(cols[0].visible_edges[0]);
-  EXPECT_NEAR(cols[0].edge_drops[0], 0.005f, 1e-6f);
-  EXPECT_FALSE(cols[1].visible_edges[3]);
+  EXPECT_TRUE(cols.edge_visible(0, 0));
+  EXPECT_NEAR(cols.edge_drop[0][0], 0.005f, 1e-6f);
+  EXPECT_FALSE(cols.edge_visible(1, 3));
   return true;
 }
 
 DELVE_TEST(hex_no_visible_edge_for_flush_neighbors) {
-  std::vector<HexColumn> cols(2);
-  cols[0].q = 0; cols[0].r = 0; cols[0].height = 0.5f;
-  cols[1].q = 1; cols[1].r = 0; cols[1].height = 0.5f;
+  HexColumnsSoA cols;
+  cols.push_back(0, 0, 0.5f, 0.5f);
+  cols.push_back(1, 0, 0.5f, 0.5f);
 
   compute_visible_edges(cols);
 
-  EXPECT_FALSE(cols[0].visible_edges[0]);
-  EXPECT_FALSE(cols[1].visible_edges[3]);
+  EXPECT_FALSE(cols.edge_visible(0, 0));
+  EXPECT_FALSE(cols.edge_visible(1, 3));
   return true;
 }
 
@@ -158,3 +160,78 @@ DELVE_TEST(hex_roundtrip_at_map_extents) {
   EXPECT_EQ(accurate, total);
   return true;
 }
+
+DELVE_TEST(rasterize_hex_matches_pixel_in_hex) {
+  const int W = 96, H = 80;
+  std::vector<HexSpan> spans;
+  std::vector<uint8_t> ref(W * H), got(W * H);
+  for (float size : {1.0f, 1.5f, 2.0f, 3.3f, 8.0f, 13.7f}) {
+    for (float org : {0.0f, -37.0f, 512.25f}) {
+      // Every hex overlapping the raster, including ones clipped at its edges.
+      std::set<std::pair<int, int>> hexes;
+      for (float y = -size; y <= H + size; y += 0.5f)
+        for (float x = -size; x <= W + size; x += 0.5f) {
+          HexCoord c = pixel_to_hex(x + org, y + org, size);
+          hexes.insert({c.q, c.r});
+        }
+      for (auto [q, r] : hexes) {
+        for (int y = 0; y < H; ++y)
+          for (int x = 0; x < W; ++x)
+            ref[y * W + x] = pixel_in_hex(x + org, y + org, q, r, size);
+        std::fill(got.begin(), got.end(), 0);
+        rasterize_hex(q, r, size, org, org, W, H, spans);
+        for (const HexSpan &sp : spans)
+          for (int x = sp.x0; x <= sp.x1; ++x)
+            got[sp.y * W + x] = 1;
+        EXPECT_TRUE(ref == got);
+      }
+    }
+  }
+  return true;
+}
+
+DELVE_TEST(hex_grid_indexes_columns_and_neighbors) {
+  HexColumnsSoA cols;
+  cols.push_back(-2, 5, 0.0f, 0.0f);
+  cols.push_back(-1, 5, 0.0f, 0.0f);
+  cols.push_back(1, 3, 0.0f, 0.0f);
+
+  HexGrid grid(cols);
+  EXPECT_EQ(grid.width, 4);
+  EXPECT_EQ(grid.height, 3);
+  EXPECT_EQ(grid.at(-2, 5), 0);
+  EXPECT_EQ(grid.at(1, 3), 2);
+  EXPECT_EQ(grid.at(0, 4), -1);
+  EXPECT_EQ(grid.at(7, 7), -1);
+  EXPECT_EQ(grid.neighbor(-2, 5, 0), 1);
+  EXPECT_EQ(grid.neighbor(-1, 5, 3), 0);
+  EXPECT_EQ(grid.neighbor(-2, 5, 3), -1);
+
+  HexGrid empty{HexColumnsSoA{}};
+  EXPECT_EQ(empty.at(0, 0), -1);
+  return true;
+}
+
+DELVE_TEST(hex_columns_soa_edges_match_record_view) {
+  // A raised column beside a lower one, with the rest of the ring missing.
+  HexColumnsSoA cols;
+  cols.push_back(0, 0, 0.8f, 0.7f);
+  cols.push_back(1, 0, 0.3f, 0.2f);
+  compute_visible_edges(cols);
+
+  EXPECT_EQ((int)cols.edge_mask[0], 0x3F);
+  EXPECT_NEAR(cols.edge_drop[0][0], 0.5f, 1e-6f);
+  EXPECT_NEAR(cols.edge_drop[1][0], 0.8f, 1e-6f);
+  EXPECT_FALSE(cols.edge_visible(1, 3));
+  EXPECT_EQ(cols.edge_drop[3][1], 0.0f);
+
+  std::vector<HexColumn> aos = cols.to_aos();
+  HexColumnsSoA back;
+  for (const HexColumn &col : aos)
+    back.push_back(col);
+  EXPECT_EQ(aos[1].base_height, 0.2f);
+  EXPECT_TRUE(back.edge_mask == cols.edge_mask);
+  for (int e = 0; e < 6; ++e)
+    EXPECT_TRUE(back.edge_drop[e] == cols.edge_drop[e]);
+  return true;
+}
@@ -31,18 +31,18 @@ static MapData make_map(int seed = 1337) {
     md.lava_bodies = std::move(fill.lava_bodies);
     md.void_bodies = std::move(fill.void_bodies);
     float interval = 1.0f / comp.terrace_levels;
-    extract_contours(md.basalt_height, MW, MH, interval, md.contour_lines, md.band_map);
-    simplify_contours(md.contour_lines, 0.5f);
+    std::vector<Line> lines;
+    extract_contours(*md.basalt_height, MW, MH, interval, lines, md.band_map);
+    md.contour_strips = stitch_contours(lines, 0.5f);
     return md;
 }
 
 static TerrainMesh make_mesh(const MapData &md) {
-    TerrainState ts; ts.current_palette = 0; ts.map_scale = 1.0f;
     ContourData cd;
-    cd.heightmap.assign(md.basalt_height.begin(), md.basalt_height.end());
-    cd.contour_lines = md.contour_lines;
+    cd.heightmap = *md.basalt_height;
+    cd.contour_strips = md.contour_strips;
     cd.band_map = md.band_map;
-    return build_terrain_mesh(ts, md, cd);
+    return build_terrain_mesh(md, cd);
 }
 
 DELVE_TEST(mesh_basalt_indices_in_bounds) {
@@ -76,6 +76,15 @@ DELVE_TEST(mesh_lava_indices_in_bounds) {
     return true;
 }
 
+DELVE_TEST(mesh_basalt_columns_index_color_stream) {
+    auto md     = make_map();
+    auto mesh   = make_mesh(md);
+    auto colors = build_column_colors(md.columns, 0);
+    EXPECT_EQ(colors.size(), md.columns.size());
+    EXPECT_GT(vertex_color_validity(mesh, colors), 0.999f);
+    return true;
+}
+
 DELVE_TEST(mesh_index_count_multiple_of_three) {
     auto md   = make_map();
     auto mesh = make_mesh(md);
@@ -203,12 +212,13 @@ DELVE_TEST(mesh_every_height_drop_has_a_wall) {
     EXPECT_LT(HEX_MIN_WALL_DROP, MAX_UNWALLED_DROP);
 
     auto md = make_map();
+    std::vector<HexColumn> cols = md.columns.to_aos();
     std::unordered_map<HexCoord, const HexColumn *, HexHash> lookup;
-    for (const auto &c : md.columns) lookup[{c.q, c.r}] = &c;
+    for (const auto &c : cols) lookup[{c.q, c.r}] = &c;
 
     const int neighbors[6][2] = {{1,0},{0,1},{-1,1},{-1,0},{0,-1},{1,-1}};
     int unwalled = 0;
-    for (const auto &c : md.columns) {
+    for (const auto &c : cols) {
         for (int i = 0; i < 6; ++i) {
             auto it = lookup.find({c.q + neighbors[i][0], c.r + neighbors[i][1]});
             if (it == lookup.end()) continue;
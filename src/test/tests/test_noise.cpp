@@ -1,6 +1,13 @@
 #include "test_harness.h"
 #include "terrain_metrics.h"
 #include "terrain/noise_layers.h"
+#include "terrain/noise_simd.h"
+#include "terrain/noise_cache.h"
+#include "terrain/noise_composer.h"
+#include "terrain/FastNoiseLite.h"
+#include "core/task_system.h"
+#include <filesystem>
+#include <fstream>
 #include <vector>
 
 static constexpr int W = 128;
@@ -78,3 +85,290 @@ DELVE_TEST(river_mask_in_binary_range) {
   }
   return true;
 }
+
+DELVE_TEST(elevation_parallel_bands_match_scalar) {
+  const int w = 200, h = 150;
+  std::vector<float> scalar, parallel;
+  ElevationParams params;
+  params.seed = 42;
+  generate_elevation_layer(scalar, w, h, params);
+
+  TaskSystem ts;
+  ts.init(4);
+  generate_elevation_layer(parallel, w, h, params, &ts);
+  ts.shutdown();
+
+  EXPECT_EQ(scalar.size(), parallel.size());
+  for (size_t i = 0; i < scalar.size(); ++i)
+    EXPECT_TRUE(scalar[i] == parallel[i]);
+  return true;
+}
+
+// FMA contraction may differ from FastNoiseLite's scalar code by an ulp of the
+// scaled coordinate, which grows with the octave frequency.
+static constexpr float SIMPLEX_ROW_TOL = 1e-4f;
+
+DELVE_TEST(simplex_row_matches_fastnoiselite) {
+  const int count = 203;
+  std::vector<float> row(count);
+  for (int seed : {0, 42, -7}) {
+    FastNoiseLite ref(seed);
+    ref.SetNoiseType(FastNoiseLite::NoiseType_OpenSimplex2);
+    ref.SetFractalType(FastNoiseLite::FractalType_None);
+    ref.SetFrequency(0.013f);
+    for (int y = -40; y < 40; y += 9) {
+      float wy = (float)y * 1.5f + 1200.0f;
+      simplex2_row(seed, 0.013f, -250.0f, 1.5f, wy, count, row.data());
+      for (int x = 0; x < count; ++x)
+        EXPECT_NEAR(row[x], ref.GetNoise((float)x * 1.5f - 250.0f, wy), SIMPLEX_ROW_TOL);
+    }
+  }
+  return true;
+}
+
+DELVE_TEST(simplex_ridged_row_matches_fastnoiselite) {
+  const int count = 203;
+  std::vector<float> row(count);
+  RiverParams rp;
+  FastNoiseLite ref(rp.seed);
+  ref.SetNoiseType(FastNoiseLite::NoiseType_OpenSimplex2);
+  ref.SetFractalType(FastNoiseLite::FractalType_Ridged);
+  ref.SetFrequency(rp.frequency);
+  ref.SetFractalOctaves(rp.octaves);
+  ref.SetFractalLacunarity(rp.lacunarity);
+  ref.SetFractalGain(rp.gain);
+  for (int y = 0; y < 64; y += 5) {
+    float wy = (float)y + 3000.0f;
+    simplex2_ridged_row(rp.seed, rp.frequency, rp.octaves, rp.lacunarity,
+                        rp.gain, 1000.0f, 1.0f, wy, count, row.data());
+    for (int x = 0; x < count; ++x)
+      EXPECT_NEAR(row[x], ref.GetNoise((float)x + 1000.0f, wy), SIMPLEX_ROW_TOL);
+  }
+  return true;
+}
+
+DELVE_TEST(cellular_sample_matches_three_fastnoiselite_passes) {
+  WorleyParams wp;
+  wp.seed = 42;
+  auto make = [&](FastNoiseLite::CellularReturnType type) {
+    FastNoiseLite n(wp.seed);
+    n.SetNoiseType(FastNoiseLite::NoiseType_Cellular);
+    n.SetCellularDistanceFunction(FastNoiseLite::CellularDistanceFunction_EuclideanSq);
+    n.SetCellularReturnType(type);
+    n.SetFrequency(wp.frequency);
+    n.SetCellularJitter(wp.jitter);
+    return n;
+  };
+  FastNoiseLite dist = make(FastNoiseLite::CellularReturnType_Distance);
+  FastNoiseLite edge = make(FastNoiseLite::CellularReturnType_Distance2Sub);
+  FastNoiseLite cell = make(FastNoiseLite::CellularReturnType_CellValue);
+
+  for (int y = 0; y < 64; ++y) {
+    for (int x = 0; x < 64; ++x) {
+      float wx = (float)x * 3.7f - 90.0f, wy = (float)y * 2.9f + 1500.0f;
+      CellularSample cs = cellular_sample(wp.seed, wp.frequency, wp.jitter, wx, wy);
+      EXPECT_NEAR(cs.distance, dist.GetNoise(wx, wy), 1e-6f);
+      EXPECT_NEAR(cs.distance2_sub, edge.GetNoise(wx, wy), 1e-6f);
+      EXPECT_NEAR(cs.cell_value, cell.GetNoise(wx, wy), 1e-6f);
+      EXPECT_NEAR(cs.cell_value, cs.cell_id * (1 / 2147483648.0f), 1e-6f);
+    }
+  }
+  return true;
+}
+
+DELVE_TEST(worley_cell_ids_agree_with_cell_values) {
+  std::vector<float> val, edge, cell;
+  std::vector<int32_t> ids;
+  WorleyParams wp;
+  wp.seed = 42;
+  generate_worley_layer(val, edge, cell, W, H, wp, &ids);
+  EXPECT_EQ(ids.size(), cell.size());
+  for (int i = 1; i < W * H; ++i) {
+    if (ids[i] == ids[i - 1])
+      EXPECT_TRUE(cell[i] == cell[i - 1]);
+  }
+  return true;
+}
+
+DELVE_TEST(worley_coarse_warp_error_is_bounded) {
+  WorleyParams wp;
+  wp.seed = 42;
+  EXPECT_NEAR(measure_worley_warp_error(W, H, wp), 0.0f, 1e-6f);
+
+  wp.warp_lattice_step = 4;
+  float err4 = measure_worley_warp_error(W, H, wp);
+  wp.warp_lattice_step = 16;
+  float err16 = measure_worley_warp_error(W, H, wp);
+  EXPECT_GT(err4, 0.0f);
+  EXPECT_LT(err4, 0.5f);
+  EXPECT_LT(err4, err16);
+  return true;
+}
+
+DELVE_TEST(worley_coarse_warp_matches_lattice_points) {
+  std::vector<float> full_v, full_e, full_c, coarse_v, coarse_e, coarse_c;
+  WorleyParams wp;
+  wp.seed = 42;
+  generate_worley_layer(full_v, full_e, full_c, W, H, wp);
+  wp.warp_lattice_step = 4;
+  generate_worley_layer(coarse_v, coarse_e, coarse_c, W, H, wp);
+
+  // Lattice nodes carry the full-rate warp, so their cells are exact.
+  int lattice_differ = 0;
+  for (int y = 0; y < H; y += 4)
+    for (int x = 0; x < W; x += 4)
+      if (full_c[y * W + x] != coarse_c[y * W + x]) ++lattice_differ;
+  EXPECT_EQ(lattice_differ, 0);
+
+  // Between nodes the interpolated warp only moves the odd cell boundary.
+  int differ = 0;
+  for (int i = 0; i < W * H; ++i)
+    if (std::abs(full_c[i] - coarse_c[i]) > 1e-6f) ++differ;
+  EXPECT_LT((float)differ, (float)(W * H) * 0.01f);
+  return true;
+}
+
+DELVE_TEST(noise_cache_toggling_seeds_reuses_buffers) {
+  NoiseCache cache;
+  RiverParams river;
+  WorleyParams worley;
+  CompositionParams comp;
+  ElevationParams seed_a, seed_b;
+  seed_a.seed = 1;
+  seed_b.seed = 2;
+
+  MapData first_a, first_b, again_a;
+  first_a.allocate(64, 64);
+  first_b.allocate(64, 64);
+  again_a.allocate(64, 64);
+  compose_layers(first_a, seed_a, river, worley, comp, &cache);
+  compose_layers(first_b, seed_b, river, worley, comp, &cache);
+  compose_layers(again_a, seed_a, river, worley, comp, &cache);
+
+  // The second visit to seed A hands back the very same buffers.
+  EXPECT_TRUE(again_a.elevation == first_a.elevation);
+  EXPECT_TRUE(again_a.worley_cell_value == first_a.worley_cell_value);
+  EXPECT_TRUE(again_a.worley_cell_id == first_a.worley_cell_id);
+  EXPECT_FALSE(first_b.elevation == first_a.elevation);
+
+  NoiseCache::Stats st = cache.stats();
+  EXPECT_EQ((int)st.misses, 4);
+  EXPECT_EQ((int)st.hits, 5);
+  EXPECT_EQ((int)st.entries, 4);
+  EXPECT_EQ((int)st.evictions, 0);
+  return true;
+}
+
+DELVE_TEST(noise_cache_evicts_least_recently_used_over_budget) {
+  auto layer = [](float v) {
+    return std::make_shared<const std::vector<float>>(256, v);
+  };
+  NoiseCache cache;
+  cache.set_byte_budget(2 * 256 * sizeof(float));
+  cache.put(NoiseCache::ELEVATION, 1, layer(1.0f));
+  cache.put(NoiseCache::ELEVATION, 2, layer(2.0f));
+
+  NoiseLayer out;
+  EXPECT_TRUE(cache.get(NoiseCache::ELEVATION, 1, out));
+  cache.put(NoiseCache::ELEVATION, 3, layer(3.0f));
+
+  EXPECT_TRUE(cache.get(NoiseCache::ELEVATION, 1, out));
+  EXPECT_EQ((*out)[0], 1.0f);
+  EXPECT_FALSE(cache.get(NoiseCache::ELEVATION, 2, out));
+  EXPECT_TRUE(cache.get(NoiseCache::ELEVATION, 3, out));
+  EXPECT_FALSE(cache.get(NoiseCache::RIVER, 3, out));
+
+  NoiseCache::Stats st = cache.stats();
+  EXPECT_EQ((int)st.evictions, 1);
+  EXPECT_EQ((int)st.entries, 2);
+  EXPECT_EQ((int)st.bytes, (int)(2 * 256 * sizeof(float)));
+  return true;
+}
+
+DELVE_TEST(noise_cache_disk_tier_survives_a_new_cache) {
+  namespace fs = std::filesystem;
+  fs::path dir = fs::temp_directory_path() / "delve_noise_cache_test";
+  fs::remove_all(dir);
+
+  ElevationParams elev;
+  elev.seed = 9;
+  RiverParams river;
+  WorleyParams worley;
+  CompositionParams comp;
+
+  MapData first;
+  first.allocate(64, 64);
+  {
+    NoiseCache cache;
+    cache.set_disk_dir(dir.string());
+    compose_layers(first, elev, river, worley, comp, &cache);
+    cache.flush_disk();
+    EXPECT_EQ((int)cache.stats().disk_writes, 3);
+  }
+
+  // A fresh cache, as after a restart, reads every layer back from disk.
+  NoiseCache cache;
+  cache.set_disk_dir(dir.string());
+  MapData again;
+  again.allocate(64, 64);
+  compose_layers(again, elev, river, worley, comp, &cache);
+  NoiseCache::Stats st = cache.stats();
+  EXPECT_EQ((int)st.disk_hits, 3);
+  EXPECT_EQ((int)st.misses, 0);
+  EXPECT_TRUE(*again.elevation == *first.elevation);
+  EXPECT_TRUE(*again.worley_edge == *first.worley_edge);
+  EXPECT_TRUE(*again.worley_cell_value == *first.worley_cell_value);
+  EXPECT_TRUE(*again.worley_cell_id == *first.worley_cell_id);
+
+  // Truncated files are treated as misses.
+  for (const auto &f : fs::directory_iterator(dir))
+    fs::resize_file(f.path(), 40);
+  NoiseCache broken;
+  broken.set_disk_dir(dir.string());
+  NoiseLayer out;
+  EXPECT_FALSE(broken.get(NoiseCache::ELEVATION,
+                          NoiseCache::layer_key(elev, 64, 64), out));
+
+  fs::remove_all(dir);
+  return true;
+}
+
+DELVE_TEST(noise_cache_disk_tier_evicts_least_recently_used_files) {
+  namespace fs = std::filesystem;
+  fs::path dir = fs::temp_directory_path() / "delve_noise_cache_evict_test";
+  fs::remove_all(dir);
+  auto layer = [](float v) {
+    return std::make_shared<const std::vector<float>>(256, v);
+  };
+  auto file_count = [&] {
+    return (int)std::distance(fs::directory_iterator(dir), fs::directory_iterator());
+  };
+
+  // Room for two layers of 1 KB plus their headers, not three.
+  NoiseCache cache;
+  cache.set_disk_dir(dir.string());
+  cache.set_disk_budget(256 * sizeof(float) * 5 / 2);
+  cache.put(NoiseCache::ELEVATION, 1, layer(1.0f));
+  cache.put(NoiseCache::ELEVATION, 2, layer(2.0f));
+  cache.flush_disk();
+  EXPECT_EQ(file_count(), 2);
+
+  // A disk hit on layer 1 makes layer 2 the least recently used file.
+  cache.invalidate_all();
+  NoiseLayer out;
+  EXPECT_TRUE(cache.get(NoiseCache::ELEVATION, 1, out));
+  cache.put(NoiseCache::ELEVATION, 3, layer(3.0f));
+  cache.flush_disk();
+  EXPECT_EQ(file_count(), 2);
+  EXPECT_EQ((int)cache.stats().disk_evictions, 1);
+
+  NoiseCache fresh;
+  fresh.set_disk_dir(dir.string());
+  EXPECT_TRUE(fresh.get(NoiseCache::ELEVATION, 1, out));
+  EXPECT_EQ((*out)[0], 1.0f);
+  EXPECT_FALSE(fresh.get(NoiseCache::ELEVATION, 2, out));
+  EXPECT_TRUE(fresh.get(NoiseCache::ELEVATION, 3, out));
+
+  fs::remove_all(dir);
+  return true;
+}
@@ -1,6 +1,7 @@
 #include "test_harness.h"
 #include "terrain/map_data.h"
 #include "terrain/terrain_lighting.h"
+#include "core/task_system.h"
 
 #include <algorithm>
 #include <cmath>
@@ -9,24 +10,38 @@
 
 static constexpr float TL_PI = 3.14159265f;
 
-static MapData make_ground_map(int w, int h, float ground) {
+static MapData make_height_map(int w, int h, std::vector<float> heights) {
   MapData map;
   map.width = w;
   map.height = h;
-  map.basalt_height.assign(w * h, ground);
+  map.basalt_height = std::make_shared<const std::vector<float>>(std::move(heights));
   return map;
 }
 
+static MapData make_ground_map(int w, int h, float ground) {
+  return make_height_map(w, h, std::vector<float>(w * h, ground));
+}
+
+// Uncorrelated heights in [0, 0.9) from an LCG.
+static MapData make_random_map(int w, int h, uint32_t s) {
+  std::vector<float> heights(w * h);
+  for (auto &v : heights) {
+    s = s * 1664525u + 1013904223u;
+    v = (float)(s >> 8) / 16777216.0f * 0.9f;
+  }
+  return make_height_map(w, h, std::move(heights));
+}
+
 static uint8_t sun_at(const TerrainLightBake &b, int x, int y) {
-  return b.rgba[(size_t)(y * b.width + x) * 4 + 0];
+  return b.rg[(size_t)(y * b.width + x) * 2 + 0];
 }
 
 static uint8_t sky_at(const TerrainLightBake &b, int x, int y) {
-  return b.rgba[(size_t)(y * b.width + x) * 4 + 1];
+  return b.rg[(size_t)(y * b.width + x) * 2 + 1];
 }
 
 static float height_at(const TerrainLightBake &b, int x, int y) {
-  return b.rgba[(size_t)(y * b.width + x) * 4 + 2] / 255.0f *
+  return (*b.heights)[(size_t)y * b.width + x] / 65535.0f *
          TERRAIN_LIGHT_HEIGHT_RANGE;
 }
 
@@ -73,7 +88,8 @@ DELVE_TEST(terrain_light_flat_field_fully_lit) {
   auto bake = bake_terrain_lighting(map);
   EXPECT_EQ(bake.width, 64);
   EXPECT_EQ(bake.height, 64);
-  EXPECT_EQ(bake.rgba.size(), (size_t)(64 * 64 * 4));
+  EXPECT_EQ(bake.rg.size(), (size_t)(64 * 64 * 2));
+  EXPECT_EQ(bake.heights->size(), (size_t)(64 * 64));
   for (int y = 4; y < 60; ++y) {
     for (int x = 4; x < 60; ++x) {
       EXPECT_EQ((int)sun_at(bake, x, y), 255);
@@ -86,10 +102,11 @@ DELVE_TEST(terrain_light_flat_field_fully_lit) {
 DELVE_TEST(terrain_light_wall_shadows_toward_plus_xy) {
   const int W = 192, Hm = 192;
   const float wall_h = 0.9f;
-  auto map = make_ground_map(W, Hm, 0.0f);
+  std::vector<float> heights(W * Hm, 0.0f);
   for (int y = 0; y < Hm; ++y)
     for (int x = 20; x <= 22; ++x)
-      map.basalt_height[y * W + x] = wall_h;
+      heights[y * W + x] = wall_h;
+  auto map = make_height_map(W, Hm, std::move(heights));
 
   TerrainLightParams P;
   auto bake = bake_terrain_lighting(map, P);
@@ -181,10 +198,11 @@ DELVE_TEST(terrain_light_height_aware_resolve_blocks_cliff_leak) {
 }
 
 DELVE_TEST(terrain_light_pit_floor_darker_sky) {
-  auto map = make_ground_map(64, 64, 0.5f);
+  std::vector<float> heights(64 * 64, 0.5f);
   for (int y = 24; y < 40; ++y)
     for (int x = 24; x < 40; ++x)
-      map.basalt_height[y * 64 + x] = 0.1f;
+      heights[y * 64 + x] = 0.1f;
+  auto map = make_height_map(64, 64, std::move(heights));
 
   auto bake = bake_terrain_lighting(map);
   EXPECT_LT((int)sky_at(bake, 32, 32), 240);
@@ -194,7 +212,8 @@ DELVE_TEST(terrain_light_pit_floor_darker_sky) {
 
 static void brute_horizon(const std::vector<float> &H, int w, int h,
                           int dx, int dy, float step,
-                          std::vector<float> &out) {
+                          std::vector<float> &out,
+                          const std::vector<HorizonOccluder> *occ = nullptr) {
   out.assign((size_t)w * h, TERRAIN_HORIZON_NONE);
   for (int y = 0; y < h; ++y) {
     for (int x = 0; x < w; ++x) {
@@ -203,7 +222,9 @@ static void brute_horizon(const std::vector<float> &H, int w, int h,
         int px = x - k * dx, py = y - k * dy;
         if (px < 0 || px >= w || py < 0 || py >= h)
           break;
-        float ang = std::atan2(H[py * w + px] - H[y * w + x], (float)k * step);
+        float oh = occ ? (*occ)[py * w + px].height : H[py * w + px];
+        float dt = occ ? (*occ)[y * w + x].offset - (*occ)[py * w + px].offset : 0.0f;
+        float ang = std::atan2(oh - H[y * w + x], (float)k * step + dt);
         best = std::max(best, ang);
       }
       out[y * w + x] = best;
@@ -234,13 +255,38 @@ DELVE_TEST(terrain_light_sweep_matches_bruteforce) {
   return true;
 }
 
-DELVE_TEST(terrain_light_bake_deterministic) {
-  auto map = make_ground_map(96, 96, 0.2f);
-  uint32_t s = 777u;
-  for (auto &v : map.basalt_height) {
+DELVE_TEST(terrain_light_sweep_occluders_match_bruteforce) {
+  const int W = 48, Hm = 40;
+  std::vector<float> H((size_t)W * Hm);
+  std::vector<HorizonOccluder> occ(H.size());
+  uint32_t s = 999u;
+  auto next = [&s] {
     s = s * 1664525u + 1013904223u;
-    v = (float)(s >> 8) / 16777216.0f * 0.9f;
+    return (float)(s >> 8) / 16777216.0f;
+  };
+  for (size_t i = 0; i < H.size(); ++i) {
+    H[i] = next() * 12.5f;
+    occ[i].height = H[i] + (next() < 0.5f ? 0.0f : next() * 4.0f);
   }
+
+  const int dirs[4][2] = {{1, 0}, {0, -1}, {1, 1}, {-1, 1}};
+  std::vector<float> fast, ref;
+  for (const auto &d : dirs) {
+    bool diagonal = d[0] != 0 && d[1] != 0;
+    float step = (diagonal ? std::sqrt(2.0f) : 1.0f) * 4.0f / 8.0f;
+    // Offsets stay inside half a step either way, like a block's reach.
+    for (HorizonOccluder &o : occ)
+      o.offset = (next() - 0.5f) * step * 0.9f;
+    sweep_horizon(H, W, Hm, d[0], d[1], step, fast, nullptr, &occ);
+    brute_horizon(H, W, Hm, d[0], d[1], step, ref, &occ);
+    for (size_t i = 0; i < fast.size(); ++i)
+      EXPECT_NEAR(fast[i], ref[i], 1e-4f);
+  }
+  return true;
+}
+
+DELVE_TEST(terrain_light_bake_deterministic) {
+  auto map = make_random_map(96, 96, 777u);
   HexColumn col{};
   col.q = 4;
   col.r = 3;
@@ -251,6 +297,91 @@ DELVE_TEST(terrain_light_bake_deterministic) {
   auto b = bake_terrain_lighting(map);
   EXPECT_EQ(a.width, b.width);
   EXPECT_EQ(a.height, b.height);
-  EXPECT_TRUE(a.rgba == b.rgba);
+  EXPECT_TRUE(a.rg == b.rg);
+
+  TaskSystem ts;
+  ts.init(3);
+  auto c = bake_terrain_lighting(map, {}, &ts);
+  ts.shutdown();
+  EXPECT_TRUE(a.rg == c.rg);
+  EXPECT_TRUE(*a.heights == *c.heights);
+  return true;
+}
+
+// Bake written out from its definition: horizons by marching every pixel
+// in all eight directions, sun as a smoothstep over the penumbra, sky as the
+// mean unoccluded fraction.
+static TerrainLightBake brute_bake(const MapData &map, const TerrainLightParams &P) {
+  const int w = map.width, h = map.height;
+  std::vector<float> H(*map.basalt_height);
+  for (float &v : H)
+    v *= P.height_scale;
+
+  const int dirs[8][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1},
+                          {1, 1}, {-1, -1}, {1, -1}, {-1, 1}};
+  std::vector<float> sun_angle, angle, sky((size_t)w * h, 0.0f);
+  for (const auto &d : dirs) {
+    bool diagonal = d[0] != 0 && d[1] != 0;
+    brute_horizon(H, w, h, d[0], d[1],
+                  (diagonal ? std::sqrt(2.0f) : 1.0f) / P.pixels_per_unit, angle);
+    for (size_t i = 0; i < angle.size(); ++i)
+      sky[i] += std::clamp(1.0f - std::sin(angle[i]), 0.0f, 1.0f) / 8.0f;
+    if (d[0] == 1 && d[1] == 1)
+      sun_angle = angle;
+  }
+
+  TerrainLightBake b;
+  b.width = w;
+  b.height = h;
+  b.rg.resize((size_t)w * h * 2);
+  for (size_t i = 0; i < sky.size(); ++i) {
+    float deg = sun_angle[i] * 180.0f / TL_PI;
+    float lo = P.sun_elevation_deg - P.penumbra_deg;
+    float s = P.penumbra_deg > 0.0f
+                  ? std::clamp((deg - lo) / (2.0f * P.penumbra_deg), 0.0f, 1.0f)
+                  : (deg < lo ? 0.0f : 1.0f);
+    float vis = 1.0f - s * s * (3.0f - 2.0f * s);
+    b.rg[i * 2 + 0] = (uint8_t)std::lround(vis * 255.0f);
+    b.rg[i * 2 + 1] = (uint8_t)std::lround(sky[i] * 255.0f);
+  }
+  return b;
+}
+
+DELVE_TEST(terrain_light_reshade_matches_bruteforce) {
+  auto map = make_random_map(40, 36, 4242u);
+
+  // One sweep serves every sun setting.
+  TerrainHorizons hz = sweep_terrain_horizons(map);
+  for (float sun : {20.0f, 55.0f, 80.0f}) {
+    for (float penumbra : {0.0f, 6.0f}) {
+      TerrainLightParams P;
+      P.sun_elevation_deg = sun;
+      P.penumbra_deg = penumbra;
+      auto reshaded = shade_terrain_light(hz, P);
+      auto ref = brute_bake(map, P);
+      EXPECT_TRUE(reshaded.heights == hz.heights);
+      for (size_t i = 0; i < ref.rg.size(); ++i)
+        EXPECT_NEAR((float)reshaded.rg[i], (float)ref.rg[i], 1.0f);
+    }
+  }
+  return true;
+}
+
+DELVE_TEST(terrain_light_reshade_after_sun_change_matches_bake) {
+  auto map = make_random_map(80, 72, 917u);
+
+  for (int div : {1, 2}) {
+    TerrainLightParams P;
+    P.resolution_divisor = div;
+    TerrainHorizons hz = sweep_terrain_horizons(map, P);
+    EXPECT_TRUE(shade_terrain_light(hz, P).rg == bake_terrain_lighting(map, P).rg);
+
+    P.sun_elevation_deg = 30.0f;
+    P.penumbra_deg = 3.0f;
+    auto reshaded = shade_terrain_light(hz, P);
+    auto baked = bake_terrain_lighting(map, P);
+    EXPECT_TRUE(reshaded.rg == baked.rg);
+    EXPECT_TRUE(*reshaded.heights == *baked.heights);
+  }
   return true;
 }
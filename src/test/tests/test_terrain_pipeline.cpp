@@ -8,9 +8,14 @@
 #include "terrain/lava.h"
 #include "terrain/contour.h"
 #include "terrain/terrain_mesh.h"
+#include "terrain/terrain_stages.h"
 #include "game_state.h"
 #include "config.h"
+#include "core/task_system.h"
+#include <climits>
 #include <cmath>
+#include <cstring>
+#include <map>
 
 static constexpr int TW = 256;
 static constexpr int TH = 256;
@@ -35,8 +40,9 @@ static MapData run_pipeline(int seed = 42) {
   md.void_bodies = std::move(fill.void_bodies);
 
   float interval = 1.0f / comp.terrace_levels;
-  extract_contours(md.basalt_height, TW, TH, interval, md.contour_lines, md.band_map);
-  simplify_contours(md.contour_lines, 0.5f);
+  std::vector<Line> lines;
+  extract_contours(*md.basalt_height, TW, TH, interval, lines, md.band_map);
+  md.contour_strips = stitch_contours(lines, 0.5f);
 
   return md;
 }
@@ -49,7 +55,7 @@ DELVE_TEST(pipeline_produces_columns) {
 
 DELVE_TEST(pipeline_no_nan_inf_elevation) {
   auto md = run_pipeline();
-  for (float v : md.final_elevation) {
+  for (float v : *md.final_elevation) {
     EXPECT_FALSE(std::isnan(v));
     EXPECT_FALSE(std::isinf(v));
   }
@@ -66,23 +72,19 @@ DELVE_TEST(pipeline_valid_terrain_map) {
 
 DELVE_TEST(pipeline_contour_lines_generated) {
   auto md = run_pipeline();
-  EXPECT_GT((float)md.contour_lines.size(), 0.0f);
+  EXPECT_GT((float)md.contour_strips.strip_count(), 0.0f);
   return true;
 }
 
 DELVE_TEST(pipeline_mesh_no_degenerate_triangles) {
   auto md = run_pipeline();
 
-  TerrainState ts;
-  ts.current_palette = 0;
-  ts.map_scale = 1.0f;
-
   ContourData cd;
-  cd.heightmap.assign(md.basalt_height.begin(), md.basalt_height.end());
-  cd.contour_lines = md.contour_lines;
+  cd.heightmap = *md.basalt_height;
+  cd.contour_strips = md.contour_strips;
   cd.band_map = md.band_map;
 
-  TerrainMesh mesh = build_terrain_mesh(ts, md, cd);
+  TerrainMesh mesh = build_terrain_mesh(md, cd);
   int degen = mesh_degenerate_triangles(mesh);
   EXPECT_EQ(degen, 0);
   return true;
@@ -105,33 +107,578 @@ DELVE_TEST(pipeline_full_resolution_1024) {
 
   EXPECT_GT((float)md.columns.size(), 0.0f);
 
-  for (float v : md.final_elevation) {
+  for (float v : *md.final_elevation) {
     EXPECT_FALSE(std::isnan(v));
     EXPECT_FALSE(std::isinf(v));
   }
 
   bool has_positive = false;
-  for (float v : md.basalt_height) {
+  for (float v : *md.basalt_height) {
     if (v > 0.0f) { has_positive = true; break; }
   }
   EXPECT_TRUE(has_positive);
   return true;
 }
 
-DELVE_TEST(pipeline_mesh_valid_normals) {
+DELVE_TEST(cleanup_replaces_small_region_with_border_mean) {
+  // A 2x2 island on level 3 inside level 1, with one level-2 pixel beside it.
+  const int W = 8, H = 8, L = 4;
+  std::vector<float> h(W * H, 0.25f);
+  for (int y = 3; y < 5; ++y)
+    for (int x = 3; x < 5; ++x)
+      h[y * W + x] = 0.75f;
+  h[3 * W + 2] = 0.5f;
+
+  cleanup_small_regions(h, W, H, L, 5, false);
+  // 20 neighbour samples off the island; the 0.5 pixel is seen twice.
+  float expected = (18 * 0.25f + 2 * 0.5f) / 20.0f;
+  EXPECT_NEAR(h[3 * W + 3], expected, 1e-6f);
+  EXPECT_NEAR(h[4 * W + 4], expected, 1e-6f);
+  // The lone 0.5 pixel was judged against the original island height.
+  EXPECT_NEAR(h[3 * W + 2], (6 * 0.25f + 2 * 0.75f) / 8.0f, 1e-6f);
+  EXPECT_NEAR(h[0], 0.25f, 1e-6f);
+  return true;
+}
+
+DELVE_TEST(cleanup_parallel_matches_serial) {
+  MapData md;
+  md.allocate(512, 512);
+  ElevationParams elev;
+  elev.seed = 11;
+  elev.map_scale = 0.5f;
+  CompositionParams comp;
+  comp.min_region_size = 400;
+  compose_layers(md, elev, RiverParams{}, WorleyParams{}, comp);
+
+  std::vector<float> levels(md.basalt_height->size());
+  const std::vector<float> &e = *md.elevation;
+  for (size_t i = 0; i < levels.size(); ++i)
+    levels[i] = std::floor(e[i] * comp.terrace_levels) / comp.terrace_levels;
+
+  std::vector<float> serial = levels, parallel = levels;
+  cleanup_small_regions(serial, 512, 512, comp.terrace_levels, comp.min_region_size, false);
+  TaskSystem ts;
+  ts.init(3);
+  cleanup_small_regions(parallel, 512, 512, comp.terrace_levels, comp.min_region_size,
+                        false, &ts);
+  ts.shutdown();
+  EXPECT_TRUE(serial == parallel);
+  EXPECT_FALSE(serial == levels);
+  return true;
+}
+
+DELVE_TEST(basalt_parallel_placement_matches_serial) {
+  MapData md;
+  md.allocate(300, 260);
+  ElevationParams elev;
+  elev.seed = 5;
+  WorleyParams worley;
+  worley.seed = 6;
+  compose_layers(md, elev, RiverParams{}, worley, CompositionParams{});
+
+  // Small hexes so several q stripes and row bands are in play.
+  MapData serial = md, parallel = md;
+  HexColumnsSoA a = generate_basalt_columns_v2(serial, 3.0f);
+  TaskSystem ts;
+  ts.init(3);
+  HexColumnsSoA b = generate_basalt_columns_v2(parallel, 3.0f, {}, &ts);
+  ts.shutdown();
+  EXPECT_GT((float)a.size(), 0.0f);
+  EXPECT_TRUE(a.q == b.q);
+  EXPECT_TRUE(a.r == b.r);
+  EXPECT_TRUE(a.height == b.height);
+  EXPECT_TRUE(a.edge_mask == b.edge_mask);
+  EXPECT_TRUE(serial.terrain_map == parallel.terrain_map);
+  return true;
+}
+
+DELVE_TEST(basalt_placement_follows_worley_cell_ids) {
+  MapData md;
+  md.allocate(200, 160);
+  ElevationParams elev;
+  elev.seed = 5;
+  WorleyParams worley;
+  worley.seed = 6;
+  compose_layers(md, elev, RiverParams{}, worley, CompositionParams{});
+
+  // Left half one cell below the density threshold, right half one cell
+  // three quarters of the way up the ID range.
+  std::vector<int32_t> ids(md.width * md.height);
+  for (int y = 0; y < md.height; ++y)
+    for (int x = 0; x < md.width; ++x)
+      ids[y * md.width + x] = x < md.width / 2 ? INT32_MIN + 7 : 0x40000000;
+  md.worley_cell_id = std::make_shared<const std::vector<int32_t>>(std::move(ids));
+
+  WorleyBasaltParams params;
+  HexColumnsSoA cols = generate_basalt_columns_v2(md, Config::HEX_SIZE, params);
+  EXPECT_GT((float)cols.size(), 0.0f);
+  for (size_t i = 0; i < cols.size(); ++i) {
+    float cx, cy;
+    hex_to_pixel(cols.q[i], cols.r[i], Config::HEX_SIZE, cx, cy);
+    EXPECT_GT(cx, md.width / 2 - Config::HEX_SIZE);
+    EXPECT_NEAR(cols.height[i] - cols.base_height[i], 0.75f * params.jitter_scale, 1e-5f);
+  }
+  return true;
+}
+
+DELVE_TEST(lava_body_masks_cover_terrain_map) {
   auto md = run_pipeline();
+  for (int16_t type : {TERRAIN_LAVA, TERRAIN_VOID}) {
+    const auto &bodies = type == TERRAIN_LAVA ? md.lava_bodies : md.void_bodies;
+    int mask_area = 0;
+    for (const LavaBody &body : bodies) {
+      EXPECT_GT((float)body.mask.area, 0.0f);
+      EXPECT_FALSE(body.mask.contains((int)body.min_x - 1, (int)body.min_y));
+      mask_area += body.mask.area;
+    }
+    int covered = 0, marked = 0;
+    for (int y = 0; y < TH; ++y)
+      for (int x = 0; x < TW; ++x) {
+        int owners = 0;
+        for (const LavaBody &body : bodies)
+          owners += body.mask.contains(x, y);
+        bool is_type = md.terrain_map[y * TW + x] == type;
+        marked += is_type;
+        covered += is_type && owners == 1;
+        EXPECT_TRUE(owners == (is_type ? 1 : 0));
+      }
+    EXPECT_EQ(covered, marked);
+    EXPECT_EQ(mask_area, marked);
+  }
+  return true;
+}
+
+DELVE_TEST(lava_keeps_regions_of_any_size) {
+  // One 90k-pixel open region, well past the old 50k component cap, and a
+  // speck below the body minimum walled off by basalt.
+  const int W = 300, H = 300;
+  MapData md;
+  md.allocate(W, H);
+  for (int y = 0; y < H; ++y)
+    for (int x = 200; x < W; ++x) {
+      bool speck = y < 3 && x > 200 && x < 206;
+      md.terrain_map[y * W + x] = speck ? TERRAIN_EMPTY : TERRAIN_BASALT;
+    }
+
+  TaskSystem ts;
+  ts.init(3);
+  auto fill = generate_lava_and_void(md, 0.0f, 3, &ts);
+  ts.shutdown();
+  EXPECT_EQ((int)fill.void_bodies.size(), 0);
+  EXPECT_EQ((int)fill.lava_bodies.size(), 1);
+  EXPECT_EQ(fill.lava_bodies[0].mask.area, 200 * 300);
+  EXPECT_EQ(md.terrain_map[0], TERRAIN_LAVA);
+  EXPECT_EQ(md.terrain_map[W - 1], TERRAIN_BASALT);
+  EXPECT_EQ(md.terrain_map[201], TERRAIN_EMPTY);
+  return true;
+}
+
+DELVE_TEST(lava_mesh_is_watertight_and_compact) {
+  // A notched disk of open ground inside basalt becomes one lava body.
+  const int W = 200, H = 200;
+  MapData md;
+  md.allocate(W, H);
+  for (int y = 0; y < H; ++y)
+    for (int x = 0; x < W; ++x) {
+      float dx = x - 100.5f, dy = y - 95.0f;
+      bool open = dx * dx + dy * dy < 70.0f * 70.0f && !(x > 90 && x < 97 && y > 100);
+      md.terrain_map[y * W + x] = open ? TERRAIN_EMPTY : TERRAIN_BASALT;
+    }
+  auto fill = generate_lava_and_void(md, 0.0f, 1);
+  EXPECT_EQ((int)fill.lava_bodies.size(), 1);
+  const LavaBody &body = fill.lava_bodies[0];
+  const auto &v = body.mesh.vertices;
+  const auto &idx = body.mesh.indices;
+  size_t tris = idx.size() / 3;
+  EXPECT_GT((float)tris, 0.0f);
+
+  std::map<std::pair<uint32_t, uint32_t>, int> directed;
+  double area = 0.0;
+  for (size_t t = 0; t < tris; ++t) {
+    uint32_t a = idx[3 * t], b = idx[3 * t + 1], c = idx[3 * t + 2];
+    double cross = (double)(v[b].x - v[a].x) * (v[c].y - v[a].y) -
+                   (double)(v[b].y - v[a].y) * (v[c].x - v[a].x);
+    EXPECT_GT((float)cross, 0.0f);  // consistent winding, nothing degenerate
+    area += 0.5 * cross;
+    ++directed[{a, b}];
+    ++directed[{b, c}];
+    ++directed[{c, a}];
+  }
+
+  // Every directed edge is used once; edges without a twin are the outline,
+  // and none of them may pass through another vertex (a T-junction).
+  int t_junctions = 0;
+  for (const auto &[e, count] : directed) {
+    EXPECT_EQ(count, 1);
+    if (directed.count({e.second, e.first})) continue;
+    const LavaVertex &p = v[e.first], &q = v[e.second];
+    for (const LavaVertex &o : v) {
+      float cross = (q.x - p.x) * (o.y - p.y) - (q.y - p.y) * (o.x - p.x);
+      float along = (o.x - p.x) * (q.x - p.x) + (o.y - p.y) * (q.y - p.y);
+      float len2 = (q.x - p.x) * (q.x - p.x) + (q.y - p.y) * (q.y - p.y);
+      if (std::abs(cross) < 1e-4f && along > 1e-4f && along < len2 - 1e-4f) ++t_junctions;
+    }
+  }
+  EXPECT_EQ(t_junctions, 0);
+
+  // Close to the body's area, with far fewer triangles than two per 2px cell.
+  EXPECT_NEAR((float)(area / body.mask.area), 1.0f, 0.05f);
+  EXPECT_LT((float)tris, body.mask.area / 2.0f / 4.0f);
+  return true;
+}
+
+DELVE_TEST(lava_mesh_covers_large_bodies) {
+  // 260x260 lattice cells: beyond the old 200x200 grid cap.
+  MapData md;
+  md.allocate(520, 520);
+  auto fill = generate_lava_and_void(md, 0.0f, 1);
+  EXPECT_EQ((int)fill.lava_bodies.size(), 1);
+  EXPECT_GT((float)fill.lava_bodies[0].mesh.indices.size(), 0.0f);
+  return true;
+}
+
+// Level-by-level marching squares as the reference for the single sweep.
+// Crossings are interpolated from each edge's left or top corner, as
+// emit_cell does.
+static std::vector<Line> contours_level_by_level(const std::vector<float> &hm, int w, int h,
+                                                 float interval) {
+  std::vector<Line> out;
+  for (float level = interval * 0.5f; level < 1.0f; level += interval) {
+    for (int y = 0; y < h - 1; ++y) {
+      for (int x = 0; x < w - 1; ++x) {
+        float h00 = hm[y * w + x], h10 = hm[y * w + x + 1];
+        float h01 = hm[(y + 1) * w + x], h11 = hm[(y + 1) * w + x + 1];
+        int config = ((h00 >= level) << 0) | ((h10 >= level) << 1) |
+                     ((h11 >= level) << 2) | ((h01 >= level) << 3);
+        if (config == 0 || config == 15) continue;
+        float fx = (float)x, fy = (float)y, p[4][2];
+        int n = 0;
+        if ((h00 < level) != (h10 < level)) {
+          float t = (level - h00) / (h10 - h00);
+          p[n][0] = fx + t; p[n][1] = fy; n++;
+        }
+        if ((h10 < level) != (h11 < level)) {
+          float t = (level - h10) / (h11 - h10);
+          p[n][0] = fx + 1; p[n][1] = fy + t; n++;
+        }
+        if ((h11 < level) != (h01 < level)) {
+          float t = (level - h01) / (h11 - h01);
+          p[n][0] = fx + t; p[n][1] = fy + 1; n++;
+        }
+        if ((h01 < level) != (h00 < level)) {
+          float t = (level - h00) / (h01 - h00);
+          p[n][0] = fx; p[n][1] = fy + t; n++;
+        }
+        if (n == 2) {
+          out.push_back({p[0][0], p[0][1], p[1][0], p[1][1], level});
+        } else if (n == 4) {
+          bool joined = (h00 + h10 + h11 + h01) * 0.25f >= level;
+          int a = joined ? 1 : 3, b = joined ? 2 : 1, c = joined ? 3 : 2;
+          out.push_back({p[0][0], p[0][1], p[a][0], p[a][1], level});
+          out.push_back({p[b][0], p[b][1], p[c][0], p[c][1], level});
+        }
+      }
+    }
+  }
+  return out;
+}
+
+DELVE_TEST(contours_single_sweep_match_level_by_level) {
+  const int W = 300, H = 229;  // several row bands, last one partial
+  std::vector<float> hm;
+  ElevationParams elev;
+  elev.seed = 21;
+  generate_elevation_layer(hm, W, H, elev);
+  // Exact level hits and flat saddles as well as smooth slopes.
+  for (int x = 0; x < W; ++x) {
+    hm[100 * W + x] = 0.0625f * 5;
+    hm[101 * W + x] = (x & 1) ? 0.9f : 0.1f;
+  }
+
+  for (int levels : {8, 13}) {
+    float interval = 1.0f / levels;
+    std::vector<Line> ref = contours_level_by_level(hm, W, H, interval);
+    std::vector<Line> serial, banded;
+    std::vector<int> bands_serial, bands_banded;
+    extract_contours(hm, W, H, interval, serial, bands_serial);
+    TaskSystem ts;
+    ts.init(3);
+    extract_contours(hm, W, H, interval, banded, bands_banded, &ts);
+    ts.shutdown();
 
-  TerrainState ts;
-  ts.current_palette = 0;
-  ts.map_scale = 1.0f;
+    EXPECT_GT((float)ref.size(), 0.0f);
+    EXPECT_EQ(serial.size(), ref.size());
+    EXPECT_EQ(banded.size(), ref.size());
+    if (serial.size() != ref.size() || banded.size() != ref.size()) return false;
+    EXPECT_EQ(std::memcmp(serial.data(), ref.data(), ref.size() * sizeof(Line)), 0);
+    EXPECT_EQ(std::memcmp(banded.data(), ref.data(), ref.size() * sizeof(Line)), 0);
+    EXPECT_TRUE(bands_serial == bands_banded);
+    EXPECT_EQ(bands_banded[(H - 1) * W + 5], (int)(hm[(H - 1) * W + 5] / interval));
+  }
+  return true;
+}
+
+// Bottom and left crossings used to be interpolated from the far corner
+// (x + 1 - t from h11, y + 1 - t from h01); the near-corner form must land
+// within a float ULP of the cell's coordinate scale.
+DELVE_TEST(contour_crossings_agree_with_far_corner_interpolation) {
+  const int W = 300, H = 229;
+  std::vector<float> hm;
+  ElevationParams elev;
+  elev.seed = 21;
+  generate_elevation_layer(hm, W, H, elev);
+
+  auto ulps_apart = [](float a, float b, float scale) {
+    return std::abs(a - b) / (std::nextafter(scale, 2.0f * scale) - scale);
+  };
+  float worst = 0.0f;
+  int crossings = 0;
+  const float interval = 1.0f / 13;
+  for (float level = interval * 0.5f; level < 1.0f; level += interval)
+    for (int y = 0; y < H - 1; ++y)
+      for (int x = 0; x < W - 1; ++x) {
+        float h00 = hm[y * W + x], h01 = hm[(y + 1) * W + x];
+        float h11 = hm[(y + 1) * W + x + 1];
+        float fx = (float)x, fy = (float)y;
+        if ((h11 < level) != (h01 < level)) {
+          float near_x = fx + (level - h01) / (h11 - h01);
+          float far_x = fx + 1 - (level - h11) / (h01 - h11);
+          worst = std::max(worst, ulps_apart(near_x, far_x, fx + 1));
+          ++crossings;
+        }
+        if ((h01 < level) != (h00 < level)) {
+          float near_y = fy + (level - h00) / (h01 - h00);
+          float far_y = fy + 1 - (level - h01) / (h00 - h01);
+          worst = std::max(worst, ulps_apart(near_y, far_y, fy + 1));
+          ++crossings;
+        }
+      }
+  EXPECT_GT((float)crossings, 1000.0f);
+  EXPECT_LT(worst, 2.0f);
+  return true;
+}
+
+DELVE_TEST(contour_strips_join_segments_within_tolerance) {
+  const int W = 160, H = 140;
+  std::vector<float> hm;
+  ElevationParams elev;
+  elev.seed = 5;
+  generate_elevation_layer(hm, W, H, elev);
+  std::vector<Line> lines;
+  std::vector<int> bands;
+  extract_contours(hm, W, H, 1.0f / 12, lines, bands);
+
+  const float tol = 0.5f;
+  ContourStrips strips = stitch_contours(lines, tol);
+  TaskSystem ts;
+  ts.init(3);
+  ContourStrips banded = stitch_contours(lines, tol, &ts);
+  ts.shutdown();
+  EXPECT_GT((float)strips.strip_count(), 0.0f);
+  EXPECT_EQ(banded.points.size(), strips.points.size());
+  EXPECT_TRUE(banded.strip_begin == strips.strip_begin);
+  EXPECT_TRUE(banded.closed == strips.closed);
+
+  // Chains only end where contours leave the map.
+  auto on_border = [&](ContourPoint p) {
+    return p.x == 0.0f || p.y == 0.0f || p.x == W - 1.0f || p.y == H - 1.0f;
+  };
+  for (size_t s = 0; s < strips.strip_count(); ++s) {
+    if (strips.closed[s]) continue;
+    EXPECT_TRUE(on_border(strips.points[strips.strip_begin[s]]));
+    EXPECT_TRUE(on_border(strips.points[strips.strip_begin[s + 1] - 1]));
+  }
+
+  // Every original endpoint stays within the tolerance of its level's strips.
+  float worst = 0.0f;
+  for (const Line &l : lines) {
+    for (ContourPoint p : {ContourPoint{l.x1, l.y1}, ContourPoint{l.x2, l.y2}}) {
+      float best = 1e30f;
+      for (size_t s = 0; s < strips.strip_count(); ++s) {
+        if (strips.elevations[s] != l.elevation) continue;
+        uint32_t b = strips.strip_begin[s], e = strips.strip_begin[s + 1];
+        for (uint32_t i = b; i < e; ++i) {
+          ContourPoint a = strips.points[i];
+          if (i + 1 == e && !strips.closed[s]) break;
+          ContourPoint c = strips.points[i + 1 < e ? i + 1 : b];
+          float dx = c.x - a.x, dy = c.y - a.y;
+          float len2 = dx * dx + dy * dy;
+          float t = len2 > 0 ? std::clamp(((p.x - a.x) * dx + (p.y - a.y) * dy) / len2, 0.0f, 1.0f)
+                             : 0.0f;
+          float ex = a.x + t * dx - p.x, ey = a.y + t * dy - p.y;
+          best = std::min(best, std::sqrt(ex * ex + ey * ey));
+        }
+      }
+      worst = std::max(worst, best);
+    }
+  }
+  EXPECT_LT(worst, tol + 1e-3f);
+
+  // Shared vertices plus simplification: far fewer than two per segment.
+  EXPECT_LT((float)strips.points.size() * 3.0f, (float)lines.size() * 2.0f);
+  return true;
+}
+
+DELVE_TEST(pipeline_mesh_valid_normals) {
+  auto md = run_pipeline();
 
   ContourData cd;
-  cd.heightmap.assign(md.basalt_height.begin(), md.basalt_height.end());
-  cd.contour_lines = md.contour_lines;
+  cd.heightmap = *md.basalt_height;
+  cd.contour_strips = md.contour_strips;
   cd.band_map = md.band_map;
 
-  TerrainMesh mesh = build_terrain_mesh(ts, md, cd);
+  TerrainMesh mesh = build_terrain_mesh(md, cd);
   float validity = normal_validity(mesh);
   EXPECT_GT(validity, 0.99f);
   return true;
 }
+
+DELVE_TEST(pipeline_preview_shares_world_units) {
+  constexpr int DS = Config::PREVIEW_DOWNSAMPLE;
+  MapData md;
+  md.allocate(TW / DS, TH / DS);
+  md.pixels_per_unit = Config::HEX_SIZE / DS;
+
+  ElevationParams elev;
+  elev.seed = 42;
+  elev.map_scale *= DS;
+  RiverParams river;
+  river.seed = 43;
+  WorleyParams worley;
+  worley.seed = 44;
+  CompositionParams comp;
+  comp.min_region_size = std::max(1, comp.min_region_size / (DS * DS));
+
+  compose_layers(md, elev, river, worley, comp, nullptr);
+  md.columns = generate_basalt_columns_v2(md, md.pixels_per_unit);
+  auto fill = generate_lava_and_void(md, comp.void_chance, worley.seed);
+  md.lava_bodies = std::move(fill.lava_bodies);
+
+  ContourData cd;
+  std::vector<Line> lines;
+  extract_contours(*md.basalt_height, md.width, md.height,
+                   1.0f / comp.terrace_levels, lines, cd.band_map);
+  cd.contour_strips = stitch_contours(lines, 0.5f);
+  EXPECT_GT((float)cd.contour_strips.strip_count(), 0.0f);
+
+  TerrainMesh mesh = build_terrain_mesh(md, cd);
+
+  const float extent = TW / Config::HEX_SIZE;
+  float max_x = 0.0f;
+  for (const auto &v : mesh.contour_vertices) {
+    EXPECT_TRUE(v.pos_x >= -0.01f && v.pos_x <= extent + 0.01f);
+    max_x = std::max(max_x, v.pos_x);
+  }
+  EXPECT_GT(max_x, extent * 0.5f);
+  return true;
+}
+
+DELVE_TEST(light_bake_coarse_tiers_stay_close_to_full) {
+  auto md = run_pipeline();
+  TerrainLightParams P;
+  P.pixels_per_unit = md.pixels_per_unit;
+  TerrainLightBake full = bake_terrain_lighting(md, P);
+
+  // A coarse sweep resolves occluders to a block, so a tier may move sun
+  // edges by up to one block. Past that band it should match the full bake
+  // to within 8 of 255 codes, and sky, a sum over eight directions, should
+  // be off by less than half of one direction on average.
+  for (int div : {2, 4}) {
+    P.resolution_divisor = div;
+    TerrainLightBake coarse = bake_terrain_lighting(md, P);
+    EXPECT_EQ(coarse.width, full.width);
+    EXPECT_EQ(coarse.height, full.height);
+    EXPECT_TRUE(*coarse.heights == *full.heights);
+    LightBakeEdgeError edge = light_bake_edge_error(full, coarse, div);
+    EXPECT_GT((float)edge.misplaced, 0.0f);
+    EXPECT_LT((float)edge.misplaced_off_edge, 0.01f * edge.misplaced);
+    EXPECT_LT(edge.off_edge_sun_rmse, 8.0f / 255.0f);
+    EXPECT_LT(light_bake_error(full, coarse).sky_rmse, 1.0f / 16.0f);
+  }
+  return true;
+}
+
+DELVE_TEST(stage_graph_reruns_only_downstream_stages) {
+  using G = TerrainStageGraph;
+  TerrainStageInputs in;
+  in.width = 128;
+  in.height = 128;
+  in.elev.seed = 5;
+  in.worley.seed = 6;
+  in.comp.min_region_size = 200;
+
+  G graph;
+  TerrainStageOutputs out;
+  auto never = [] { return false; };
+  EXPECT_TRUE(graph.run(in, nullptr, nullptr, never, out));
+  for (int s = 0; s < G::STAGE_COUNT; ++s)
+    EXPECT_EQ(graph.run_count((G::Stage)s), 1);
+  auto first_mesh = out.mesh;
+  auto first_bake = out.light_bake;
+  auto first_map = out.map;
+  EXPECT_TRUE(first_map != nullptr);
+
+  // The map is only handed out with a rebuilt mesh.
+  EXPECT_TRUE(graph.run(in, nullptr, nullptr, never, out));
+  EXPECT_TRUE(out.mesh == first_mesh);
+  EXPECT_TRUE(out.map == nullptr);
+  EXPECT_EQ(graph.run_count(G::COMPOSE), 1);
+  EXPECT_EQ(graph.run_count(G::MESH), 1);
+
+  // A sun-angle tweak only reshades the cached horizons.
+  in.light.sun_elevation_deg += 10.0f;
+  EXPECT_TRUE(graph.stale(in, G::LIGHT));
+  EXPECT_FALSE(graph.stale(in, G::HORIZONS));
+  EXPECT_FALSE(graph.stale(in, G::COMPOSE));
+  EXPECT_TRUE(graph.run(in, nullptr, nullptr, never, out));
+  EXPECT_EQ(graph.run_count(G::LIGHT), 2);
+  EXPECT_EQ(graph.run_count(G::HORIZONS), 1);
+  EXPECT_EQ(graph.run_count(G::MESH), 1);
+  EXPECT_TRUE(out.mesh == first_mesh);
+  EXPECT_FALSE(out.light_bake == first_bake);
+
+  // A palette swap only recolors; the mesh is reused as is.
+  auto first_colors = out.column_colors;
+  in.terrain.current_palette = 1;
+  EXPECT_TRUE(graph.run(in, nullptr, nullptr, never, out));
+  EXPECT_EQ(graph.run_count(G::COLORS), 2);
+  EXPECT_EQ(graph.run_count(G::MESH), 1);
+  EXPECT_EQ(graph.run_count(G::LAVA), 1);
+  EXPECT_TRUE(out.mesh == first_mesh);
+  EXPECT_FALSE(out.column_colors == first_colors);
+  EXPECT_EQ(out.column_colors->size(), first_map->columns.size());
+
+  // Void chance feeds lava and, through it, the mesh.
+  in.comp.void_chance = 0.9f;
+  EXPECT_TRUE(graph.run(in, nullptr, nullptr, never, out));
+  EXPECT_EQ(graph.run_count(G::LAVA), 2);
+  EXPECT_EQ(graph.run_count(G::MESH), 2);
+  EXPECT_EQ(graph.run_count(G::COLORS), 2);
+  EXPECT_EQ(graph.run_count(G::BASALT), 1);
+  EXPECT_EQ(graph.run_count(G::LIGHT), 2);
+  EXPECT_TRUE(out.map != nullptr);
+  EXPECT_TRUE(out.map->basalt_height == first_map->basalt_height);
+  return true;
+}
+
+DELVE_TEST(stage_graph_abort_keeps_finished_stages) {
+  using G = TerrainStageGraph;
+  TerrainStageInputs in;
+  in.width = 96;
+  in.height = 96;
+
+  G graph;
+  TerrainStageOutputs out;
+  int polls = 0;
+  auto abort_after_basalt = [&] { return ++polls > 2; };
+  EXPECT_FALSE(graph.run(in, nullptr, nullptr, abort_after_basalt, out));
+  EXPECT_EQ(graph.run_count(G::COMPOSE), 1);
+  EXPECT_EQ(graph.run_count(G::BASALT), 1);
+  EXPECT_TRUE(out.mesh == nullptr);
+
+  EXPECT_TRUE(graph.run(in, nullptr, nullptr, [] { return false; }, out));
+  EXPECT_EQ(graph.run_count(G::COMPOSE), 1);
+  EXPECT_EQ(graph.run_count(G::MESH), 1);
+  EXPECT_TRUE(out.mesh != nullptr);
+  return true;
+}
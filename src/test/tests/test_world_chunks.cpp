@@ -0,0 +1,184 @@
+#include "test_harness.h"
+#include "terrain/world_chunks.h"
+#include "config.h"
+#include <algorithm>
+#include <cmath>
+#include <set>
+#include <utility>
+#include <vector>
+
+static ChunkedWorld make_world(int chunk_size = 64, int halo = 32) {
+  ChunkedWorldParams wp;
+  wp.chunk_size = chunk_size;
+  wp.halo = halo;
+  wp.load_radius = 1;
+  ElevationParams elev;
+  elev.seed = 42;
+  RiverParams river;
+  river.seed = 43;
+  WorleyParams worley;
+  worley.seed = 44;
+  CompositionParams comp;
+  comp.min_region_size = 50;
+
+  ChunkedWorld world;
+  world.configure(wp, elev, river, worley, comp);
+  return world;
+}
+
+// Contour points on the world line x = line (vertical) or y = line, sorted.
+static std::vector<std::pair<float, float>> crossings(const WorldChunk &c, bool vertical,
+                                                      float line) {
+  std::vector<std::pair<float, float>> out;
+  const ContourStrips &s = c.map.contour_strips;
+  for (size_t k = 0; k < s.strip_count(); ++k)
+    for (uint32_t i = s.strip_begin[k]; i < s.strip_begin[k + 1]; ++i) {
+      const ContourPoint &p = s.points[i];
+      if ((vertical ? p.x : p.y) == line)
+        out.push_back({vertical ? p.y : p.x, s.elevations[k]});
+    }
+  std::sort(out.begin(), out.end());
+  return out;
+}
+
+DELVE_TEST(world_chunk_noise_matches_one_large_raster) {
+  ChunkedWorld world = make_world();
+  WorldChunk chunk = world.generate({1, -1});
+
+  // One raster spanning chunk (1,-1) plus margin, normalised the same way.
+  MapData big;
+  big.allocate(256, 192);
+  big.origin_x = -32;
+  big.origin_y = -96;
+  ElevationParams elev;
+  elev.seed = 42;
+  RiverParams river;
+  river.seed = 43;
+  WorleyParams worley;
+  worley.seed = 44;
+  CompositionParams comp;
+  NoiseRanges ranges = world.ranges();
+  compose_layers(big, elev, river, worley, comp, nullptr, nullptr, &ranges);
+
+  int mismatches = 0;
+  for (int y = 0; y < 64; ++y) {
+    for (int x = 0; x < 64; ++x) {
+      int ci = y * 64 + x;
+      int bi = (y + chunk.map.origin_y - big.origin_y) * big.width +
+               (x + chunk.map.origin_x - big.origin_x);
+      if ((*chunk.map.elevation)[ci] != (*big.elevation)[bi]) ++mismatches;
+      if ((*chunk.map.river_mask)[ci] != (*big.river_mask)[bi]) ++mismatches;
+      if ((*chunk.map.worley_cell_value)[ci] != (*big.worley_cell_value)[bi]) ++mismatches;
+      if ((*chunk.map.worley_cell_id)[ci] != (*big.worley_cell_id)[bi]) ++mismatches;
+    }
+  }
+  EXPECT_EQ(mismatches, 0);
+  return true;
+}
+
+DELVE_TEST(world_chunks_agree_across_border) {
+  ChunkedWorld world = make_world();
+  WorldChunk a = world.generate({0, 0});
+  WorldChunk b = world.generate({1, 0});
+
+  // The shared sample column x = 64 is the last contour column of `a` and the
+  // first of `b`; both must cut it at the same points.
+  auto ea = crossings(a, true, 64.0f);
+  EXPECT_GT((float)ea.size(), 0.0f);
+  EXPECT_TRUE(ea == crossings(b, true, 64.0f));
+
+  std::set<std::pair<int, int>> owned;
+  for (size_t i = 0; i < a.map.columns.size(); ++i)
+    owned.insert({a.map.columns.q[i], a.map.columns.r[i]});
+  int duplicates = 0;
+  for (size_t i = 0; i < b.map.columns.size(); ++i)
+    if (owned.count({b.map.columns.q[i], b.map.columns.r[i]})) ++duplicates;
+  EXPECT_EQ(duplicates, 0);
+  EXPECT_GT((float)(a.map.columns.size() + b.map.columns.size()), 0.0f);
+  return true;
+}
+
+DELVE_TEST(world_chunk_cleanup_matches_one_large_raster) {
+  ChunkedWorld world = make_world();
+  const CompositionParams &comp = world.composition();
+  EXPECT_EQ(comp.min_region_size, 50);
+  EXPECT_GT((float)comp.max_region_extent, 0.0f);
+
+  // One raster over chunks (0,0) and (1,0) plus a halo's margin, cleaned up
+  // with the same extent limit; each chunk must match it pixel for pixel.
+  MapData big;
+  big.allocate(192, 128);
+  big.origin_x = -32;
+  big.origin_y = -32;
+  ElevationParams elev;
+  elev.seed = 42;
+  RiverParams river;
+  river.seed = 43;
+  WorleyParams worley;
+  worley.seed = 44;
+  NoiseRanges ranges = world.ranges();
+  compose_layers(big, elev, river, worley, comp, nullptr, nullptr, &ranges);
+
+  int mismatches = 0, cleaned = 0;
+  for (ChunkCoord coord : {ChunkCoord{0, 0}, ChunkCoord{1, 0}}) {
+    WorldChunk chunk = world.generate(coord);
+    for (int y = 0; y < 64; ++y)
+      for (int x = 0; x < 64; ++x) {
+        int bi = (y + chunk.map.origin_y - big.origin_y) * big.width +
+                 (x + chunk.map.origin_x - big.origin_x);
+        float h = (*chunk.map.basalt_height)[y * 64 + x];
+        if (h != (*big.basalt_height)[bi]) ++mismatches;
+        float terraced = std::floor((*big.elevation)[bi] * comp.terrace_levels) /
+                         comp.terrace_levels;
+        if (h != terraced) ++cleaned;
+      }
+  }
+  EXPECT_EQ(mismatches, 0);
+  EXPECT_GT((float)cleaned, 0.0f);
+  return true;
+}
+
+DELVE_TEST(world_chunks_follow_camera) {
+  ChunkedWorld world = make_world(32, 16);
+  EXPECT_EQ(world.update(0.0f, 0.0f), 9);
+  EXPECT_EQ((int)world.loaded_count(), 9);
+  EXPECT_EQ(world.update(1.0f, 1.0f), 0);
+
+  // One chunk east: a new column of three, the old ring is still in range.
+  const float chunk_units = 32 / Config::HEX_SIZE;
+  EXPECT_EQ(world.update(chunk_units * 1.5f, 0.0f), 3);
+  EXPECT_EQ((int)world.loaded_count(), 12);
+
+  // Far away: everything is replaced.
+  EXPECT_EQ(world.update(chunk_units * 20.5f, 0.0f), 9);
+  EXPECT_EQ((int)world.loaded_count(), 9);
+  EXPECT_TRUE(world.find({20, 0}) != nullptr);
+  EXPECT_TRUE(world.find({0, 0}) == nullptr);
+  return true;
+}
+
+DELVE_TEST(world_chunks_agree_across_border_at_default_settings) {
+  // Default chunk and composition parameters, where small-region cleanup
+  // could otherwise decide a region differently on each side of a seam.
+  for (int seed : {42, 7, 1337}) {
+    ElevationParams elev;
+    elev.seed = seed;
+    RiverParams river;
+    river.seed = seed * 7 + 1;
+    WorleyParams worley;
+    worley.seed = seed * 13 + 3;
+    ChunkedWorld world;
+    world.configure(ChunkedWorldParams{}, elev, river, worley, CompositionParams{});
+
+    // The four chunks around the world origin, meeting on x = 0 and y = 0.
+    WorldChunk nw = world.generate({-1, -1}), ne = world.generate({0, -1});
+    WorldChunk sw = world.generate({-1, 0}), se = world.generate({0, 0});
+    auto nw_east = crossings(nw, true, 0.0f), nw_south = crossings(nw, false, 0.0f);
+    EXPECT_GT((float)(nw_east.size() + nw_south.size()), 0.0f);
+    EXPECT_TRUE(nw_east == crossings(ne, true, 0.0f));
+    EXPECT_TRUE(nw_south == crossings(sw, false, 0.0f));
+    EXPECT_TRUE(crossings(sw, true, 0.0f) == crossings(se, true, 0.0f));
+    EXPECT_TRUE(crossings(ne, false, 0.0f) == crossings(se, false, 0.0f));
+  }
+  return true;
+}